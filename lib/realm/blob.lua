@@ -0,0 +1,64 @@
+local native = require "realm.native"
+
+---@class Realm.BlobReader
+---@field chunkSize integer The number of bytes read at a time.
+---@field offset integer The offset of the next chunk.
+---@field _object Realm.Object The object.
+---@field _property Realm.Schema.PropertyInformation The binary property.
+local RealmBlobReader = {}
+RealmBlobReader.__index = RealmBlobReader
+
+-- The number of bytes read at a time if not specified.
+local DEFAULT_CHUNK_SIZE = 64 * 1024
+
+---Read the next chunk of the blob.
+---@return string? chunk The next chunk, or nil when the whole blob has been read.
+function RealmBlobReader:read()
+    local chunk = native.realm_object_read_blob(self._object, self._property.key, self.offset, self.chunkSize)
+    if chunk == nil or #chunk == 0 then
+        return nil
+    end
+    self.offset = self.offset + #chunk
+
+    return chunk
+end
+
+---Write the rest of the blob to a stream, such as a luv stream, one chunk at
+---a time. The next chunk is only read once the previous one has been written,
+---so at most one chunk is buffered.
+---@param stream { write: fun(self: any, data: string, callback: fun(err: string?)) } The stream.
+---@param onDone fun(err: string?)? The callback called once the blob has been written or on error.
+function RealmBlobReader:pipe(stream, onDone)
+    local function writeNext(err)
+        if err ~= nil then
+            if onDone then onDone(err) end
+            return
+        end
+        local status, chunk = pcall(self.read, self)
+        if not status then
+            if onDone then onDone(chunk) end
+            return
+        end
+        if chunk == nil then
+            if onDone then onDone(nil) end
+            return
+        end
+        stream:write(chunk, writeNext)
+    end
+    writeNext(nil)
+end
+
+---@param object Realm.Object The object.
+---@param property Realm.Schema.PropertyInformation The binary property.
+---@param chunkSize integer? The number of bytes read at a time.
+---@return Realm.BlobReader
+function RealmBlobReader._new(object, property, chunkSize)
+    return setmetatable({
+        _object = object,
+        _property = property,
+        chunkSize = chunkSize or DEFAULT_CHUNK_SIZE,
+        offset = 0,
+    }, RealmBlobReader)
+end
+
+return RealmBlobReader
@@ -1,12 +1,13 @@
 ---@module "realm.scheduler"
 
----@alias Realm.Schema.PropertyType string | "bool" | "int" | "double" | "string"
+---@alias Realm.Schema.PropertyType string | "bool" | "int" | "double" | "string" | "data"
 
 ---Externally defined classes
 ---@see Realm.App
 ---@see Realm.App.User
 ---@see Realm.Object
 ---@see Realm.Results
+---@see Realm.Query
 ---@see Realm.List
 ---@see Realm.Set
 
@@ -15,9 +16,29 @@
 ---@field schemaVersion integer The version of the schema for the realm being opened.
 ---@field schema Realm.Schema.ClassDefinition[] The schema containing all classes and their properties.
 ---@field scheduler Realm.Scheduler? The scheduler which the realm should be bound to.
+---@field priority Realm.Config.Priority? The priority of the notifications and other work of the realm on the default scheduler, default is "interactive".
+---@field inMemory boolean? Whether to keep the realm in memory only, never writing it to disk, default is false.
+---@field durability Realm.Config.Durability? How commits are made durable, default is "full".
+---@field groupCommit (boolean | Realm.Config.GroupCommit)? Whether to queue writes and apply those queued within a window in a single write transaction, default is false.
 ---@field sync Realm.Config.Sync? The configuration for opening a synced realm.
 ---@field _cached boolean? Whether to return a cached Realm instance, default is true.
 
+---@alias Realm.Config.Priority
+---| "interactive" # Run before the work of background realms.
+---| "background" # Run once there is no work of interactive realms.
+
+---@alias Realm.Config.Durability
+---| "full" # Sync the changes to disk on every commit. Raises if Realm.disableSyncToDisk has been called.
+---| "memOnly" # Keep the realm in memory only, like inMemory.
+
+---@class Realm.Config.GroupCommit
+---@field windowMs integer? The time in milliseconds writes are queued for before being applied, default is 0 (until the event loop gets to them).
+
+---@class Realm.ImportOptions
+---@field format ("ndjson" | "csv")? The format of the file, default is "csv" for files ending in ".csv" and "ndjson" otherwise.
+---@field batchSize integer? The number of records written per write transaction, default is 10000.
+---@field threads integer? The number of threads parsing the records, default is the number of cores minus two.
+
 ---@alias Realm.Handle userdata
 
 ---@class Realm.ObjectChanges
@@ -26,14 +47,28 @@
 
 ---@alias Realm.ObjectChanges.Callback fun(object: Realm.Object, changes: Realm.ObjectChanges) 
 
----@class Realm.CollectionChanges
+---@class Realm.CollectionChanges The changes of a collection, only readable within the listener. The indices are read lazily, so `#changes.insertions` does not build an array.
 ---@field deletions number[] The indices of the deleted objects at their previous positions.
 ---@field insertions number[] The indices of the added objects at their current positions.
 ---@field modificationsOld number[] The indices of the modified objects at their previous positions.
 ---@field modificationsNew number[] The indices of the modified objects at their current positions.
+---@field deletionRanges fun(self: Realm.CollectionChanges) : fun(): integer?, integer? Iterate over the first and last index of each range of deletions.
+---@field insertionRanges fun(self: Realm.CollectionChanges) : fun(): integer?, integer? Iterate over the first and last index of each range of insertions.
+---@field modificationOldRanges fun(self: Realm.CollectionChanges) : fun(): integer?, integer? Iterate over the first and last index of each range of modifications at their previous positions.
+---@field modificationNewRanges fun(self: Realm.CollectionChanges) : fun(): integer?, integer? Iterate over the first and last index of each range of modifications at their current positions.
+
+---@class Realm.ListenerOptions Options limiting the rate of the notifications of a listener. The changes received in between are merged into one notification, delivered with the timer of the scheduler.
+---@field maxRate number? The maximum number of notifications per second.
+---@field coalesce boolean? Whether to merge the changes received until the event loop runs the timer, without a maximum rate.
 
 ---@alias Realm.CollectionChanges.Callback fun(results: Realm.Results, changes: Realm.CollectionChanges)
 
+---@class Realm.View A string or binary value read without copying it, valid until the realm advances to another version or a write transaction begins. Supports `#`, `==`, `<` and `<=`, and `tostring` copies it into a Lua string.
+---@field sub fun(self: Realm.View, i: integer?, j: integer?) : string Copy the bytes from i to j, like string.sub.
+---@field equals fun(self: Realm.View, other: Realm.View | string) : boolean Compare the bytes with another view or a string.
+---@field tostring fun(self: Realm.View) : string Copy the bytes into a Lua string.
+---@field isValid fun(self: Realm.View) : boolean Whether the view can still be read.
+
 ---@class Realm.Config.Sync
 ---@field user Realm.App.User The currently logged in user.
 ---@field partitionValue string The value used for syncing objects with its partition key field set to this value.
@@ -43,6 +78,9 @@
 ---@field key integer The class key.
 ---@field properties table<string, Realm.Schema.PropertyDefinition> The property names containing their definitions.
 ---@field primaryKey string The property that is the primary key field.
+---@field metatable table The metatable of the objects of the class.
+---@field valueNames string[] The names of the properties holding single values.
+---@field valueKeys userdata The keys of the properties holding single values, in the order of their names.
 
 ---@class Realm.Schema.ClassDefinition Schema classes definition used to open a Realm.
 ---@field name string The class name.
@@ -17,7 +17,7 @@ function RealmDictionary:new(realm, handle, classInfo)
         _realm = realm,
         class = classInfo,
     }
-    table.insert(realm._childHandles, dictionary._handle)
+    native.realm_track_handle(realm._handle, dictionary._handle)
 
     return setmetatable(dictionary, RealmDictionary)
 end
@@ -34,9 +34,6 @@ end
 --- @param key string The key to look up in the set.
 --- @param value string | number | boolean | Realm.Object The value to add to the dictionary.
 function RealmDictionary:__newindex(key, value)
-    if type(value) == "table" then
-        value = value._handle
-    end
     if value == nil then
         native.realm_dictionary_erase(self._handle, key)
         return
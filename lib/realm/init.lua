@@ -4,18 +4,24 @@ local scheduler = require "realm.scheduler"
 ---@module '.classes'
 
 local RealmObject = require "realm.object"
+local RealmQuery = require "realm.query"
 local RealmResults = require "realm.results"
 
 ---@classmod realm
 ---@class Realm
 ---@field _handle userdata The realm userdata.
 ---@field _schema table<string, Realm.Schema.ClassInformation> The schema used when opening the realm.
----@field _childHandles userdata[] The userdata associated with the opened realm.
+---@field _classesByKey table<integer, Realm.Schema.ClassInformation> The classes of the schema by class key.
+---@field _queryCache userdata The cache of parsed queries.
+---@field _config Realm.Config? The configuration the realm was opened with, or nil for frozen realms.
+---@field _groupCommitWindow integer? The time in milliseconds writes are queued for with group commit, or nil without it.
+---@field _pendingWrites { callback: fun(): any, onCommitted: fun(err: string?, result: any)? }[] The writes queued with group commit.
 local Realm = {}
 Realm.__index = Realm
 
 function Realm:__gc()
-    self:close()
+    -- Pending writes are not run from a finalizer, they fail instead.
+    self:_release("Realm was collected before its queued writes were applied")
 end
 
 function Realm:__close()
@@ -36,10 +42,112 @@ local function _safeGetClass(realm, className)
     return classInfo
 end
 
+---Notify the callers of queued writes of their outcome. The error of a write
+---without onCommitted is raised instead, as is the first error raised by an
+---onCommitted, once every caller has been notified.
+---@param writes { callback: fun(): any, onCommitted: fun(err: string?, result: any)? }[] The writes.
+---@param errors table<integer, string?> The errors of the writes, by index.
+---@param results table<integer, any> The results of the writes, by index.
+local function _notifyWrites(writes, errors, results)
+    local firstError
+    for index, write in ipairs(writes) do
+        local err = errors[index]
+        if write.onCommitted ~= nil then
+            local status, result = xpcall(write.onCommitted, debug.traceback, err, err == nil and results[index] or nil)
+            if not status then
+                firstError = firstError or result
+            end
+        elseif err ~= nil then
+            firstError = firstError or err
+        end
+    end
+    if firstError ~= nil then
+        error(firstError)
+    end
+end
+
+---Run the queued writes of a realm with group commit in a single write
+---transaction. A write which fails is cancelled by replaying the others
+---without it, so every write succeeds or fails on its own, and callbacks may
+---run several times. Every caller is notified, even if the transaction cannot
+---begin or another caller raises.
+---@param realm Realm The realm.
+local function _flushWrites(realm)
+    local writes = realm._pendingWrites
+    if #writes == 0 then
+        return
+    end
+    realm._pendingWrites = {}
+
+    local results, errors = {}, {}
+    local committed, commitError
+    repeat
+        local failed = false
+        local began, beginError = pcall(native.realm_begin_write, realm._handle)
+        if not began then
+            committed, commitError = false, beginError
+            break
+        end
+        for index, write in ipairs(writes) do
+            if errors[index] == nil then
+                local status, result = xpcall(write.callback, debug.traceback)
+                if not status then
+                    errors[index] = result
+                    failed = true
+                    break
+                end
+                results[index] = result
+            end
+        end
+        if failed then
+            native.realm_cancel_transaction(realm._handle)
+        else
+            committed, commitError = pcall(native.realm_commit_transaction, realm._handle)
+        end
+    until not failed
+
+    if not committed then
+        for index = 1, #writes do
+            errors[index] = errors[index] or commitError
+        end
+    end
+    _notifyWrites(writes, errors, results)
+end
+
+---Fail the queued writes of a realm with group commit without running them.
+---@param realm Realm The realm.
+---@param err string The error passed to the callers.
+local function _failWrites(realm, err)
+    local writes = realm._pendingWrites
+    realm._pendingWrites = {}
+    local errors = {}
+    for index = 1, #writes do
+        errors[index] = err
+    end
+    _notifyWrites(writes, errors, {})
+end
+
+---Apply changes to the realm in a write transaction. With group commit, the
+---changes are queued and applied along with the other writes queued within
+---the window, and the result is passed to onCommitted instead. The callback
+---is then run again whenever another queued write fails, so it must only
+---change the realm. The error of a failed write without onCommitted is raised
+---from the event loop.
 ---@generic T
 ---@param writeCallback fun(): T The callback performing the changes to apply to the realm.
+---@param onCommitted fun(err: string?, result: T?)? With group commit, the callback called once the changes are committed, or with the error if the write failed.
 ---@return T
-function Realm:write(writeCallback)
+function Realm:write(writeCallback, onCommitted)
+    if self._groupCommitWindow ~= nil then
+        table.insert(self._pendingWrites, { callback = writeCallback, onCommitted = onCommitted })
+        if #self._pendingWrites == 1 then
+            scheduler.timer(self._groupCommitWindow, function()
+                _flushWrites(self)
+            end)
+        end
+        return nil
+    end
+
     native.realm_begin_write(self._handle)
     local status, result = xpcall(writeCallback, debug.traceback)
     if (status) then
@@ -51,6 +159,16 @@ function Realm:write(writeCallback)
     error(result)
 end
 
+---Perform changes in a write transaction which begins once the write lock has
+---been acquired, without blocking the thread, on the scheduler of the realm.
+---The commit returns without waiting for the changes to be written to disk.
+---@param writeCallback fun() The callback performing the changes to apply to the realm.
+---@param onCommitted fun(err: string?)? The callback called once the changes are written to disk, or with the error if the write failed.
+---@return integer transactionId The id of the write transaction.
+function Realm:writeAsync(writeCallback, onCommitted)
+    return native.realm_async_write(self._handle, writeCallback, onCommitted)
+end
+
 ---@param className string The class name.
 ---@param values table? The values to apply to the object.
 ---@param handle userdata? The realm object userdata.
@@ -60,44 +178,170 @@ function Realm:create(className, values, handle)
     return RealmObject._new(self, _safeGetClass(self, className), values, handle)
 end
 
+---Create many objects of a class in one native call. Must be called within a write transaction.
+---@param className string The class name.
+---@param rows table<string, any>[] The values of every object to create.
+---@param returnObjects boolean? Whether to return the created objects.
+---@generic T : Realm.Object
+---@return T[]?
+function Realm:createMany(className, rows, returnObjects)
+    local classInfo = _safeGetClass(self, className)
+    local handles = native.realm_object_create_many(self._handle, classInfo.key, rows, returnObjects)
+    if handles == nil then
+        return nil
+    end
+    for index, handle in ipairs(handles) do
+        handles[index] = RealmObject._new(self, classInfo, nil, handle)
+    end
+
+    return handles
+end
+
+---Import the records of a NDJSON or CSV file (with a header naming the
+---properties) as new objects of a class. The records are parsed on other
+---threads and written in a write transaction per batch, so the batches
+---written before an error are kept. Must not be called within a write transaction.
+---@param path string The path to the file.
+---@param className string The class name.
+---@param options Realm.ImportOptions? The options of the import.
+---@return integer count The number of objects imported.
+function Realm:import(path, className, options)
+    _flushWrites(self)
+    local classInfo = _safeGetClass(self, className)
+    options = options or {}
+    local format = options.format or (path:match("%.csv$") and "csv" or "ndjson")
+
+    return native.realm_import(self._handle, path, classInfo.key, format, options.batchSize, options.threads)
+end
+
 ---Explicitly close this realm and its associated userdata (release native resources).
+---The queued writes are applied first, and their errors raised once the realm is closed.
 function Realm:close()
-    for _, handle in ipairs(self._childHandles) do
-        native.realm_release(handle)
+    local flushed, flushError = pcall(_flushWrites, self)
+    self:_release()
+    if not flushed then
+        error(flushError, 0)
+    end
+end
+
+---Release the native resources of the realm, failing the writes still queued.
+---@param err string? The error passed to the callers of the queued writes.
+function Realm:_release(err)
+    if #self._pendingWrites > 0 then
+        pcall(_failWrites, self, err or "Realm was closed before its queued writes were applied")
+    end
+    native.realm_query_cache_clear(self._queryCache)
+    native.realm_release_handles(self._handle)
+    -- Objects are not tracked, so closing the realm invalidates them. Cached
+    -- realms share their instance with the other realms opened on the same
+    -- loop, so they are only released.
+    local config = self._config
+    if config == nil or config._cached == false then
+        native.realm_close(self._handle)
     end
     native.realm_release(self._handle)
 end
 
+---Call a function and release the objects, results, collections and other
+---handles created within it when it returns, rather than when they are collected.
+---@generic T
+---@param scopeCallback fun(): T The callback to call.
+---@return T
+function Realm:scope(scopeCallback)
+    local marker = native.realm_scope_begin(self._handle)
+    local status, result = xpcall(scopeCallback, debug.traceback)
+    native.realm_scope_end(self._handle, marker)
+    if (status) then
+        return result
+    end
+
+    error(result)
+end
+
 ---@param object Realm.Object The object.
 function Realm:delete(object)
-    return native.realm_object_delete(object._handle)
+    return native.realm_object_delete(object)
 end
 
 ---@param object Realm.Object The object.
 function Realm:isValid(object)
-    return native.realm_object_is_valid(object._handle)
+    return native.realm_object_is_valid(object)
 end
 
 ---@param className string The class name.
 ---@return Realm.Results
 function Realm:objects(className)
     local classInfo = _safeGetClass(self, className)
-    local resultHandle = native.realm_object_get_all(self._handle, className)
+    local resultHandle = native.realm_object_get_all(self._handle, classInfo.key)
 
     return RealmResults._new(self, resultHandle, classInfo)
 end
 
+---Prepare a query to be run repeatedly with different arguments. The query is
+---parsed now to raise its errors, with null arguments if it has any. Realm
+---binds the arguments when parsing, so a query with arguments is parsed again
+---on every run, while one without is parsed once and cached.
+---@param className string The class name.
+---@param queryString string The query string.
+---@return Realm.Query
+function Realm:prepare(className, queryString)
+    return RealmQuery._new(self, _safeGetClass(self, className), queryString)
+end
+
+---@param handle userdata The realm userdata.
+---@param schema table<string, Realm.Schema.ClassInformation> The classes of the schema by name.
+---@param classesByKey table<integer, Realm.Schema.ClassInformation> The classes of the schema by class key.
+---@return Realm
+local function _new(handle, schema, classesByKey)
+    return setmetatable({
+        _handle = handle,
+        _schema = schema,
+        _classesByKey = classesByKey,
+        _queryCache = native.realm_query_cache_new(),
+        _pendingWrites = {},
+    }, Realm)
+end
+
+---Get an immutable snapshot of the realm at its current version, which never
+---changes nor needs a scheduler. Close it once done to let the version go.
+---@return Realm
+function Realm:freeze()
+    return _new(native.realm_freeze(self._handle), self._schema, self._classesByKey)
+end
+
+---Get a token owning a frozen realm, to be imported once with Realm.importFrozen,
+---for instance by a task of workers it is passed to. The realm is released with
+---the token if it is never imported.
+---@return userdata
+function Realm:exportFrozen()
+    return native.realm_export_frozen(self._handle)
+end
+
+---Never sync the changes of any realm of the process to disk from now on, so
+---that a crash of the system may lose or corrupt them. This cannot be undone,
+---and realms can no longer be opened with full durability.
+function Realm.disableSyncToDisk()
+    native.realm_disable_sync_to_disk()
+end
+
+---Import a frozen realm exported by Realm:exportFrozen, possibly from another Lua state.
+---@param ref userdata The token of the frozen realm, which can only be imported once.
+---@return Realm
+function Realm.importFrozen(ref)
+    return _new(native.realm_import_frozen(ref, RealmObject))
+end
+
 ---@param config Realm.Config The configuration for opening the realm.
 ---@return Realm
 function Realm.open(config)
-    local scheduler = config.scheduler and native.realm_clone(config.scheduler) or scheduler.defaultFactory()
-    local _handle, _schema = native.realm_open(config, scheduler)
+    local scheduler = config.scheduler and native.realm_clone(config.scheduler) or scheduler.defaultFactory(config.priority)
+    local _handle, _schema, _classesByKey = native.realm_open(config, scheduler, RealmObject)
     native.realm_release(scheduler)
-    local self = setmetatable({
-        _handle = _handle,
-        _schema = _schema,
-        _childHandles = setmetatable({}, { __mode = "v"}) -- A table of weak references.
-    }, Realm)
+    local self = _new(_handle, _schema, _classesByKey)
+    self._config = config
+    if config.groupCommit then
+        self._groupCommitWindow = type(config.groupCommit) == "table" and config.groupCommit.windowMs or 0
+    end
 
     return self
 end
@@ -17,7 +17,7 @@ function RealmList:new(realm, handle, classInfo)
         _realm = realm,
         class = classInfo,
     }
-    table.insert(realm._childHandles, list._handle)
+    native.realm_track_handle(realm._handle, list._handle)
 
     return setmetatable(list, RealmList)
 end
@@ -39,10 +39,6 @@ function RealmList:__newindex(index, value)
         native.realm_list_erase(self._handle, index - 1)
         return
     end
-    -- A realm object type in Lua will correspond to a "table"
-    if type(value) == "table" then
-        value = value._handle
-    end
     native.realm_list_insert(self._handle, index - 1, value)
 end
 
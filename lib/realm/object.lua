@@ -1,4 +1,5 @@
 local native = require "realm.native"
+local scheduler = require "realm.scheduler"
 local classes = require "realm.classes"
 
 ---@module '.init'
@@ -7,29 +8,140 @@ local classes = require "realm.classes"
 ---@field _handle userdata The realm object userdata.
 ---@field _realm Realm The realm userdata.
 ---@field class Realm.Schema.ClassInformation The class information.
----@field addListener fun(self: Realm.Object, cb: Realm.ObjectChanges.Callback) : Realm.Handle Add a listener to listen to change notifications.
+---@field addListener fun(self: Realm.Object, cb: Realm.ObjectChanges.Callback, keyPaths: string[]?, options: Realm.ListenerOptions?) : Realm.Handle Add a listener to listen to change notifications, optionally only of the given properties.
+---@field toTable fun(self: Realm.Object, props: string[]?) : table<string, any> Read the values of the object into a plain table.
+---@field view fun(self: Realm.Object, prop: string) : Realm.View? View a string or binary value without copying it.
+---@field readBlob fun(self: Realm.Object, prop: string, offset: integer?, len: integer) : string?, integer? Read part of a binary value and get its total size.
+---@field writeBlob fun(self: Realm.Object, prop: string, chunks: string[] | fun(): string?) Write a binary value from chunks, gathered in memory before it is set.
+---@field blobReader fun(self: Realm.Object, prop: string, chunkSize: integer?) : Realm.BlobReader Read a binary value in chunks.
+---@field freeze fun(self: Realm.Object, frozen: Realm?) : Realm.Object?, Realm? Get an immutable snapshot of the object in a frozen realm, and that realm.
 local RealmObject = {}
 
 ---@param self Realm.Object The object.
 ---@param onObjectChange Realm.ObjectChanges.Callback The callback to be notified on changes.
+---@param keyPaths string[]? The properties to be notified of changes to (e.g. "status" or "owner.name"), or nil for all of them.
+---@param options Realm.ListenerOptions? The options limiting the rate of the notifications.
 ---@return Realm.Handle
-local function addListener(self, onObjectChange)
+local function addListener(self, onObjectChange, keyPaths, options)
     -- Create a listener that is passed to cpp which, when called, in turn calls
     -- the user's listener (onObjectChange). This makes it possible to pass the
     -- object (self) from Lua instead of cpp.
     local function listener(changes)
         onObjectChange(self, changes)
     end
-    local notificationToken = native.realm_object_add_listener(self._handle, listener)
-    table.insert(self._realm._childHandles, notificationToken)
+    local notificationToken = native.realm_object_add_listener(
+        self,
+        self._realm._handle,
+        self.class.key,
+        keyPaths,
+        scheduler._listenerInterval(options),
+        scheduler.timer,
+        listener
+    )
+    native.realm_track_handle(self._realm._handle, notificationToken)
 
     return notificationToken
 end
 
+---@param self Realm.Object The object.
+---@param props string[]? The names of the properties to read, or nil to read all properties.
+---@return table<string, any>
+local function toTable(self, props)
+    -- All single values are read in one native call, references come back as
+    -- object handles and collections are left out.
+    local values = native.realm_get_values(self._realm._handle, self, self.class, props)
+
+    local function wrap(prop)
+        local property = self.class.properties[prop]
+        if property.collectionType ~= nil then
+            values[prop] = self[prop]
+        elseif property.objectType ~= nil and values[prop] ~= nil then
+            values[prop] = RealmObject._new(self._realm, self._realm._schema[property.objectType], nil, values[prop])
+        end
+    end
+    if props ~= nil then
+        for _, prop in ipairs(props) do
+            wrap(prop)
+        end
+    else
+        for prop in pairs(self.class.properties) do
+            wrap(prop)
+        end
+    end
+
+    return values
+end
+
+---@param self Realm.Object The object.
+---@param prop string The name of a property.
+---@return Realm.Schema.PropertyInformation
+local function _getProperty(self, prop)
+    local property = self.class.properties[prop]
+    if property == nil then
+        error("Property '" .. prop .. "' not found on type " .. self.class.name)
+    end
+
+    return property
+end
+
+---@param self Realm.Object The object.
+---@param prop string The name of a string or binary property.
+---@return Realm.View?
+local function view(self, prop)
+    return native.realm_object_get_view(self, _getProperty(self, prop).key)
+end
+
+---@param self Realm.Object The object.
+---@param prop string The name of a binary property.
+---@param offset integer? The zero-based offset of the first byte to read.
+---@param len integer The maximum number of bytes to read.
+---@return string? bytes The bytes read, or nil if the value is null.
+---@return integer? size The size of the whole value.
+local function readBlob(self, prop, offset, len)
+    return native.realm_object_read_blob(self, _getProperty(self, prop).key, offset or 0, len)
+end
+
+---Must be called within a write transaction. The value can only be set whole,
+---so the chunks are gathered in memory first, which takes the size of the
+---whole value plus a copy of it while it is set.
+---@param self Realm.Object The object.
+---@param prop string The name of a binary property.
+---@param chunks string[] | fun(): string? The chunks, or a function returning the next chunk until nil.
+local function writeBlob(self, prop, chunks)
+    native.realm_object_write_blob(self, _getProperty(self, prop).key, chunks)
+end
+
+---@param self Realm.Object The object.
+---@param prop string The name of a binary property.
+---@param chunkSize integer? The number of bytes read at a time.
+---@return Realm.BlobReader
+local function blobReader(self, prop, chunkSize)
+    local RealmBlobReader = require "realm.blob"
+    return RealmBlobReader._new(self, _getProperty(self, prop), chunkSize)
+end
+
+---@param self Realm.Object The object.
+---@param frozen Realm? The frozen realm to resolve the object in, or nil to freeze the realm of the object.
+---@return Realm.Object? object The object in the frozen realm, or nil if it has been deleted.
+---@return Realm? frozen The frozen realm, to be closed by the caller once done if it was created.
+local function freeze(self, frozen)
+    local owned = frozen == nil
+    frozen = frozen or self._realm:freeze()
+    local handle = native.realm_object_resolve_in(self, frozen._handle)
+    if handle == nil then
+        if owned then
+            frozen:close()
+        end
+        return nil
+    end
+
+    return RealmObject._new(frozen, self.class, nil, handle), frozen
+end
+
 ---@param realm Realm The realm.
 ---@param classInfo Realm.Schema.ClassInformation The class information.
 ---@param values table<string, any>? The values of the object.
----@param handle userdata? The realm object userdata.
+---@param handle userdata? The realm object userdata or object proxy.
 ---@return Realm.Object 
 function RealmObject._new(realm, classInfo, values, handle)
     local noPrimaryKey = (classInfo.primaryKey == nil or classInfo.primaryKey == '')
@@ -49,14 +161,12 @@ function RealmObject._new(realm, classInfo, values, handle)
         end
     end
 
-    local object = {
-        _handle = handle,
-        _realm = realm,
-        class = classInfo,
-        addListener = addListener,
-    }
-    table.insert(realm._childHandles, object._handle)
-    object = setmetatable(object, RealmObject)
+    -- The object is a single userdata proxy which holds the object natively,
+    -- handles created by other natives are converted into one.
+    local object = handle
+    if not RealmObject._isObject(object) then
+        object = native.realm_object_to_proxy(handle, realm, classInfo)
+    end
     if not hasHandle and hasValues then
         -- Insert rest of the values into the created object
         for prop, value in pairs(values) do
@@ -67,42 +177,68 @@ function RealmObject._new(realm, classInfo, values, handle)
     return object
 end
 
----@param schema table<string, Realm.Schema.ClassInformation> The schema containing the classes and their information.
+---Check whether a value is a Realm object.
+---@param value any The value.
+---@return boolean
+function RealmObject._isObject(value)
+    local metatable = getmetatable(value)
+
+    return metatable ~= nil and metatable.__realmObject == true
+end
+
+---@param realm Realm The realm.
 ---@param classKey number The class key.
 ---@return Realm.Schema.ClassInformation
-local function _findClass(schema, classKey)
-    for _, classInfo in pairs(schema) do
-        if classInfo.key == classKey then
-            return classInfo
-        end
+local function _findClass(realm, classKey)
+    local classInfo = realm._classesByKey[classKey]
+    if classInfo == nil then
+        error("Given a class key without a cached class")
     end
-    error("Given a class key without a cached class")
 
-    return {}
+    return classInfo
 end
 
+-- The metatable of each class reads and writes single values natively and
+-- only falls back to RealmObject:__index and RealmObject:__newindex for
+-- references and collections.
+
+-- The methods of every object.
+local methods = {
+    addListener = addListener,
+    toTable = toTable,
+    view = view,
+    readBlob = readBlob,
+    writeBlob = writeBlob,
+    blobReader = blobReader,
+    freeze = freeze,
+}
+
 --- @param prop string The property name.
 function RealmObject:__index(prop)
+    local method = methods[prop]
+    if method ~= nil then
+        return method
+    end
     local property = self.class.properties[prop]
     local targetClassInfo = self._realm._schema[property.objectType]
     if (property.collectionType == classes.CollectionType.List) then
         local RealmList = require "realm.list"
-        local listHandle = native.realm_get_list(self._handle, property.key)
+        local listHandle = native.realm_get_list(self, property.key)
         return RealmList:new(self._realm, listHandle, targetClassInfo)
     elseif (property.collectionType == classes.CollectionType.Dictionary) then
         local RealmDictionary = require "realm.dictionary"
-        local dictionaryHandle = native.realm_get_dictionary(self._handle, property.key)
+        local dictionaryHandle = native.realm_get_dictionary(self, property.key)
         return RealmDictionary:new(self._realm, dictionaryHandle, targetClassInfo)
     elseif (property.collectionType == classes.CollectionType.Set) then
         local RealmSet = require "realm.set"
-        local setHandle = native.realm_get_set(self._handle, property.key)
+        local setHandle = native.realm_get_set(self, property.key)
         return RealmSet:new(self._realm, setHandle, targetClassInfo)
     end
 
     -- refClass is only returned if the field is a reference to an object.
-    local value, refClassKey = native.realm_get_value(self._realm._handle, self._handle, property.key)
+    local value, refClassKey = native.realm_get_value(self._realm._handle, self, property.key)
     if refClassKey ~= nil then
-        return RealmObject._new(self._realm, _findClass(self._realm._schema, refClassKey), nil, value)
+        return RealmObject._new(self._realm, _findClass(self._realm, refClassKey), nil, value)
     end
 
     return value
@@ -117,14 +253,10 @@ function RealmObject:__newindex(prop, value)
     end
     -- Ensure only Realm Objects are set for references to fields.
     if (type(value) == "table") then
-        if getmetatable(value) ~= RealmObject then
-            local targetClassInfo = self._realm._schema[property.objectType]
-            value = RealmObject._new(self._realm, targetClassInfo, value)
-        end
-        native.realm_set_value(self._realm._handle, self._handle, property.key, value._handle)
-        return
+        local targetClassInfo = self._realm._schema[property.objectType]
+        value = RealmObject._new(self._realm, targetClassInfo, value)
     end
-    native.realm_set_value(self._realm._handle, self._handle, property.key, value)
+    native.realm_set_value(self._realm._handle, self, property.key, value)
 end
 
 return RealmObject
@@ -0,0 +1,35 @@
+local native = require "realm.native"
+local RealmResults = require "realm.results"
+
+---@class Realm.Query
+---@field class Realm.Schema.ClassInformation The class information.
+---@field queryString string The query string.
+---@field _realm Realm The realm.
+local RealmQuery = {}
+RealmQuery.__index = RealmQuery
+
+---Run the query over all objects of its class with the given positional arguments.
+---@return Realm.Results
+function RealmQuery:run(...)
+    local realm = self._realm
+    local handle = native.realm_query_find_all(realm._handle, realm._queryCache, self.class.key, self.queryString, select('#', ...), ...)
+
+    return RealmResults._new(realm, handle, self.class)
+end
+
+---@param realm Realm The realm.
+---@param classInfo Realm.Schema.ClassInformation The class information.
+---@param queryString string The query string.
+---@return Realm.Query
+function RealmQuery._new(realm, classInfo, queryString)
+    -- Parse the query now so that its errors are raised here rather than when it runs.
+    native.realm_query_prepare(realm._handle, realm._queryCache, classInfo.key, queryString)
+
+    return setmetatable({
+        _realm = realm,
+        class = classInfo,
+        queryString = queryString,
+    }, RealmQuery)
+end
+
+return RealmQuery
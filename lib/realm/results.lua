@@ -1,26 +1,50 @@
 local native = require "realm.native"
+local scheduler = require "realm.scheduler"
 local RealmObject = require "realm.object"
 
 ---@class Realm.Results
 ---@field class Realm.Schema.ClassInformation The class information.
----@field addListener fun(self: Realm.Results, cb: Realm.CollectionChanges.Callback) : Realm.Handle Add a listener to listen to change notifications.
+---@field addListener fun(self: Realm.Results, cb: Realm.CollectionChanges.Callback, keyPaths: string[]?, options: Realm.ListenerOptions?) : Realm.Handle Add a listener to listen to change notifications, optionally only of the given properties.
 ---@field filter function Filter objects from the results.
+---@field iter fun(self: Realm.Results, chunkSize: integer?) : fun(): integer?, Realm.Object? Iterate over the objects.
+---@field column fun(self: Realm.Results, prop: string) : any[], integer Get the values of a property of all objects.
+---@field sum fun(self: Realm.Results, prop: string) : number Sum the values of a property.
+---@field min fun(self: Realm.Results, prop: string) : any? Get the smallest value of a property.
+---@field max fun(self: Realm.Results, prop: string) : any? Get the largest value of a property.
+---@field average fun(self: Realm.Results, prop: string) : number? Average the values of a property.
+---@field sorted fun(self: Realm.Results, keyPaths: string | string[], ascending: boolean | boolean[] | nil) : Realm.Results Sort the results.
+---@field distinct fun(self: Realm.Results, keyPaths: string | string[]) : Realm.Results Keep only the first object of each distinct value.
+---@field limit fun(self: Realm.Results, count: integer) : Realm.Results Keep only the first objects.
+---@field freeze fun(self: Realm.Results, frozen: Realm?) : Realm.Results, Realm Get an immutable snapshot of the results in a frozen realm, and that realm.
 ---@field _handle userdata The realm results userdata.
 ---@field _realm Realm The realm.
 local RealmResults = {}
 
+-- The number of objects fetched per native call when iterating.
+local DEFAULT_CHUNK_SIZE = 64
+
 ---@param self Realm.Results The realm results.
 ---@param onCollectionChange Realm.CollectionChanges.Callback The callback to be notified on changes.
+---@param keyPaths string[]? The properties to be notified of changes to (e.g. "status" or "owner.name"), or nil for all of them.
+---@param options Realm.ListenerOptions? The options limiting the rate of the notifications.
 ---@return Realm.Handle
-local function addListener(self, onCollectionChange)
+local function addListener(self, onCollectionChange, keyPaths, options)
     -- Create a listener that is passed to cpp which, when called, in turn calls
     -- the user's listener (onCollectionChange). This makes it possible to pass
     -- the result (self) from Lua instead of cpp.
     local function listener(changes)
         onCollectionChange(self, changes)
     end
-    local notificationToken = native.realm_results_add_listener(self._handle, listener)
-    table.insert(self._realm._childHandles, notificationToken)
+    local notificationToken = native.realm_results_add_listener(
+        self._handle,
+        self._realm._handle,
+        self.class.key,
+        keyPaths,
+        scheduler._listenerInterval(options),
+        scheduler.timer,
+        listener
+    )
+    native.realm_track_handle(self._realm._handle, notificationToken)
 
     return notificationToken
 end
@@ -29,11 +53,151 @@ end
 ---@param queryString string The query string.
 ---@return Realm.Results
 local function filter(self, queryString, ...)
-    local handle = native.realm_results_filter(self._handle, self._realm._handle, self.class.name, queryString, select('#', ...), ...)
+    local handle = native.realm_results_filter(self._handle, self._realm._handle, self.class.key, queryString, self._realm._queryCache, select('#', ...), ...)
+
+    return RealmResults._new(self._realm, handle, self.class)
+end
+
+---@param self Realm.Results The realm results.
+---@param chunkSize integer? The number of objects to fetch per native call.
+---@return fun(): integer?, Realm.Object?
+local function iter(self, chunkSize)
+    chunkSize = chunkSize or DEFAULT_CHUNK_SIZE
+    local cursor = native.realm_results_iter(self._handle)
+    native.realm_track_handle(self._realm._handle, cursor)
+
+    local chunk = {}
+    local chunkLength = 0
+    local chunkIndex = 0
+    local index = 0
+    return function()
+        if chunkIndex == chunkLength then
+            chunkLength = native.realm_results_iter_next(cursor, chunk, chunkSize, self._realm, self.class)
+            chunkIndex = 0
+            if chunkLength == 0 then
+                return nil
+            end
+        end
+        chunkIndex = chunkIndex + 1
+        index = index + 1
+
+        return index, chunk[chunkIndex]
+    end
+end
+
+---Get the information of a property of the class of the results, otherwise throw an error.
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return Realm.Schema.PropertyInformation
+local function _safeGetProperty(self, prop)
+    local property = self.class.properties[prop]
+    if property == nil then
+        error("Property '" .. prop .. "' not found on type " .. self.class.name)
+    end
+
+    return property
+end
+
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return any[] values The values at the positions of their objects (nil values leave holes).
+---@return integer count The number of objects.
+local function column(self, prop)
+    local property = _safeGetProperty(self, prop)
+    local values, count = native.realm_results_get_column(self._handle, self._realm._handle, self.class.key, property.key)
+    if property.objectType ~= nil then
+        local targetClassInfo = self._realm._schema[property.objectType]
+        for index = 1, count do
+            if values[index] ~= nil then
+                values[index] = RealmObject._new(self._realm, targetClassInfo, nil, values[index])
+            end
+        end
+    end
+
+    return values, count
+end
+
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return number
+local function sum(self, prop)
+    return native.realm_results_sum(self._handle, self._realm._handle, _safeGetProperty(self, prop).key) or 0
+end
+
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return any? # Nil if the results are empty.
+local function min(self, prop)
+    return native.realm_results_min(self._handle, self._realm._handle, _safeGetProperty(self, prop).key)
+end
+
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return any? # Nil if the results are empty.
+local function max(self, prop)
+    return native.realm_results_max(self._handle, self._realm._handle, _safeGetProperty(self, prop).key)
+end
+
+---@param self Realm.Results The realm results.
+---@param prop string The property name.
+---@return number? # Nil if the results are empty.
+local function average(self, prop)
+    return native.realm_results_average(self._handle, self._realm._handle, _safeGetProperty(self, prop).key)
+end
+
+---@param self Realm.Results The realm results.
+---@param keyPaths string | string[] The key paths to sort by, in order of precedence.
+---@param ascending boolean | boolean[] | nil Whether to sort in ascending order, for all or for each key path. Default is true.
+---@return Realm.Results
+local function sorted(self, keyPaths, ascending)
+    if type(keyPaths) == "string" then
+        keyPaths = { keyPaths }
+    end
+    local ascendingFlags = {}
+    for index = 1, #keyPaths do
+        if type(ascending) == "table" then
+            ascendingFlags[index] = ascending[index] ~= false
+        else
+            ascendingFlags[index] = ascending ~= false
+        end
+    end
+    local handle = native.realm_results_sort(self._handle, keyPaths, ascendingFlags)
+
+    return RealmResults._new(self._realm, handle, self.class)
+end
+
+---@param self Realm.Results The realm results.
+---@param keyPaths string | string[] The key paths whose combined values must be distinct.
+---@return Realm.Results
+local function distinct(self, keyPaths)
+    if type(keyPaths) == "string" then
+        keyPaths = { keyPaths }
+    end
+    local handle = native.realm_results_distinct(self._handle, keyPaths)
+
+    return RealmResults._new(self._realm, handle, self.class)
+end
+
+---@param self Realm.Results The realm results.
+---@param count integer The maximum number of objects.
+---@return Realm.Results
+local function limit(self, count)
+    local handle = native.realm_results_limit(self._handle, count)
 
     return RealmResults._new(self._realm, handle, self.class)
 end
 
+---@param self Realm.Results The realm results.
+---@param frozen Realm? The frozen realm to resolve the results in, or nil to freeze the realm of the results.
+---@return Realm.Results results The results in the frozen realm.
+---@return Realm frozen The frozen realm, to be closed by the caller once done if it was created.
+local function freeze(self, frozen)
+    frozen = frozen or self._realm:freeze()
+    local handle = native.realm_results_resolve_in(self._handle, frozen._handle)
+
+    return RealmResults._new(frozen, handle, self.class), frozen
+end
+
 ---@param realm Realm The realm.
 ---@param handle userdata The realm results userdata.
 ---@param classInfo Realm.Schema.ClassInformation The class information.
@@ -45,18 +209,31 @@ function RealmResults._new(realm ,handle, classInfo)
         class = classInfo,
         addListener = addListener,
         filter = filter,
+        iter = iter,
+        column = column,
+        sum = sum,
+        min = min,
+        max = max,
+        average = average,
+        sorted = sorted,
+        distinct = distinct,
+        limit = limit,
+        freeze = freeze,
     }
-    table.insert(realm._childHandles, results._handle)
+    native.realm_track_handle(realm._handle, results._handle)
 
     return setmetatable(results, RealmResults)
 end
 
 ---@param index number The index of the object to get.
----@return Realm.Object
+---@return Realm.Object?
 function RealmResults:__index(index)
-    local objectHandle = native.realm_results_get(self._handle, index - 1)
+    return native.realm_results_get(self._handle, index - 1, self._realm, self.class)
+end
 
-    return RealmObject._new(self._realm, self.class, nil, objectHandle)
+---@return fun(): integer?, Realm.Object?
+function RealmResults:__pairs()
+    return iter(self)
 end
 
 ---@return number
@@ -3,9 +3,39 @@ local scheduler = {}
 --- @class Realm.Scheduler : userdata
 
 ---A default factory for Realm.Scheduler. Must be set if not explicitly opening realms with a predefined scheduler.
+---@param priority Realm.Config.Priority? The priority of the work of the realm.
 ---@return Realm.Scheduler
-function scheduler.defaultFactory()
+function scheduler.defaultFactory(priority)
     error("No scheduler has been set.")
 end
 
+---Call a function once after a delay on the thread of the event loop. Must be
+---set to add listeners with a maximum rate or coalescing.
+---@param milliseconds integer The delay.
+---@param callback fun() The function to call.
+function scheduler.timer(milliseconds, callback)
+    error("No scheduler timer has been set.")
+end
+
+---Get the interval in milliseconds between deliveries of a listener with the
+---given options, or nil to deliver every change as it comes.
+---@param options Realm.ListenerOptions? The options of the listener.
+---@return integer?
+function scheduler._listenerInterval(options)
+    if options == nil then
+        return nil
+    end
+    if options.maxRate ~= nil then
+        if options.maxRate <= 0 then
+            error("The maximum rate of a listener must be positive")
+        end
+        return math.ceil(1000 / options.maxRate)
+    end
+    if options.coalesce then
+        return 0
+    end
+
+    return nil
+end
+
 return scheduler
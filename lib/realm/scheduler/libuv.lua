@@ -2,20 +2,49 @@ local uv = require "luv"
 local scheduler = require "realm.scheduler"
 local native = require "realm.scheduler.libuv.native"
 
-scheduler.defaultFactory = function()
-    local async, scheduler, userdata
+local libuv = {
+    ---The time in milliseconds the work of the realms may run for each time
+    ---the loop gets to it, before yielding to the other handles of the loop.
+    ---Set to 0 to run all of it at once.
+    budget = 5,
+}
 
-    async = uv.new_async(function()
-        if (userdata:should_close()) then
-            async:close(function()
-                userdata:close()
-            end)
-        else
-            userdata:do_work();
-        end
-    end)
+-- The async handle of the loop and the work of every realm, run in order of
+-- priority. They are created with the first scheduler and closed once every
+-- scheduler has been destroyed.
+local async, queue
+
+---@param priority Realm.Config.Priority? The priority of the work of the realm.
+scheduler.defaultFactory = function(priority)
+    if queue == nil then
+        async = uv.new_async(function()
+            if queue:should_close() then
+                async:close()
+                async, queue = nil, nil
+            elseif queue:do_work(libuv.budget) then
+                -- Come back to the rest of the work on the next iteration of the loop.
+                async:send()
+            end
+        end)
+        queue = native.create_queue(async)
+    end
+
+    local status, result = pcall(native.create_scheduler, queue, priority)
+    if not status then
+        -- Let the async handle close if no scheduler uses it.
+        async:send()
+        error(result)
+    end
 
-    userdata, scheduler = native.create_scheduler(async)
+    return result
+end
 
-    return scheduler
+scheduler.timer = function(milliseconds, callback)
+    local timer = uv.new_timer()
+    timer:start(milliseconds, 0, function()
+        timer:close()
+        callback()
+    end)
 end
+
+return libuv
@@ -0,0 +1,78 @@
+local scheduler = require "realm.scheduler"
+local native = require "realm.scheduler.native.native"
+
+---A scheduler running the work of the realms on a loop of its own, without
+---luv. Either call `run()`, or poll `fd()` from the loop of the host and call
+---`runOnce(0)` when it is readable.
+local loop = {
+    ---The time in milliseconds the work of the realms may run for each
+    ---iteration of the loop. Set to 0 to run all of it at once.
+    budget = 5,
+}
+
+-- The queue of the work of every realm, woken up through its fd.
+local queue = native.create_loop()
+
+-- The pending timers, ordered by their deadline.
+---@type { deadline: number, callback: fun() }[]
+local timers = {}
+
+local stopped = false
+
+---@param priority Realm.Config.Priority? The priority of the work of the realm.
+scheduler.defaultFactory = function(priority)
+    return native.create_scheduler(queue, priority)
+end
+
+scheduler.timer = function(milliseconds, callback)
+    local timer = { deadline = native.now() + milliseconds, callback = callback }
+    local index = #timers + 1
+    while index > 1 and timers[index - 1].deadline > timer.deadline do
+        index = index - 1
+    end
+    table.insert(timers, index, timer)
+end
+
+---Get the file descriptor which becomes readable when the realms have work to run.
+---@return integer
+function loop.fd()
+    return queue:fd()
+end
+
+---Wait for work or a timer for up to the timeout, then run the timers which
+---are due and the work of the realms within the budget.
+---@param timeoutMs integer? The time to wait for in milliseconds, 0 to not wait or nil to wait until there is work.
+function loop.runOnce(timeoutMs)
+    local timeout = timeoutMs or -1
+    if #timers > 0 then
+        local untilTimer = math.max(math.ceil(timers[1].deadline - native.now()), 0)
+        if timeout < 0 or untilTimer < timeout then
+            timeout = untilTimer
+        end
+    end
+    queue:wait(timeout)
+
+    local now = native.now()
+    while #timers > 0 and timers[1].deadline <= now do
+        table.remove(timers, 1).callback()
+    end
+    if queue:do_work(loop.budget) then
+        -- Come back to the rest of the work on the next iteration.
+        queue:wake()
+    end
+end
+
+---Run the loop until `stop()` is called, or until no realm is open and no timer is pending.
+function loop.run()
+    stopped = false
+    while not stopped and (queue:has_schedulers() or #timers > 0) do
+        loop.runOnce()
+    end
+end
+
+---Stop `run()` after the current iteration.
+function loop.stop()
+    stopped = true
+end
+
+return loop
@@ -16,24 +16,18 @@ function RealmSet:new(realm, handle, classInfo)
         _realm = realm,
         class = classInfo,
     }
-    table.insert(realm._childHandles, set._handle)
+    native.realm_track_handle(realm._handle, set._handle)
     return setmetatable(set, RealmSet)
 end
 
 --- @param value any The value to look up in the set.
 function RealmSet:__index(value)
-    if type(value) == "table" then
-        value = value._handle
-    end
     return native.realm_set_find(self._handle, value)
 end
 
 --- @param entry string | number | boolean | Realm.Object The entry to add to the set.
 --- @param value true | nil True implies that the entry should be inserted in the set. Nil means deletion.
 function RealmSet:__newindex(entry, value)
-    if type(entry) == "table" then
-        entry = entry._handle
-    end
     if value == nil then
         native.realm_set_erase(self._handle, entry)
         return
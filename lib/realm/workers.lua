@@ -0,0 +1,197 @@
+local native = require "realm.native"
+local workersNative = require "realm.workers.native"
+local scheduler = require "realm.scheduler"
+local RealmObject = require "realm.object"
+local RealmQuery = require "realm.query"
+local RealmResults = require "realm.results"
+
+---@class Realm.Workers.Options
+---@field threads integer? The number of threads, default is the number of cores.
+
+---A pool of threads, each running its own Lua state with its own instance of
+---a realm, to run queries and transformations on all cores. Tasks are sent to
+---the other Lua states as bytecode, and objects, results and queries passed
+---to or returned from them as thread-safe references.
+---@class Realm.Workers
+---@field _realm Realm The realm the results are resolved in.
+---@field _pool userdata? The native pool, or nil once closed.
+---@field _pending table<integer, fun(err: string?, result: any) | false> The callbacks of the tasks which have not completed yet.
+---@field _nextId integer The id of the next task.
+local Workers = {}
+Workers.__index = Workers
+
+function Workers:__gc()
+    self:close()
+end
+
+function Workers:__close()
+    self:close()
+end
+
+---Replace the objects, results and queries in a value by tables which can be
+---sent to another Lua state, holding thread-safe references.
+---@param value any The value.
+---@return any
+local function _pack(value)
+    if RealmObject._isObject(value) then
+        return { __realm = "object", class = value.class.name, ref = native.realm_create_thread_safe_reference(value) }
+    end
+    local metatable = getmetatable(value)
+    if metatable == RealmResults then
+        return { __realm = "results", class = value.class.name, ref = native.realm_create_thread_safe_reference(value._handle) }
+    elseif metatable == RealmQuery then
+        return { __realm = "query", class = value.class.name, queryString = value.queryString }
+    elseif type(value) == "table" then
+        local packed = {}
+        for key, entry in pairs(value) do
+            packed[key] = _pack(entry)
+        end
+        return packed
+    end
+
+    return value
+end
+
+---Resolve the objects, results and queries of a value packed by another Lua state.
+---@param realm Realm The realm of this Lua state.
+---@param value any The packed value.
+---@return any
+local function _unpack(realm, value)
+    if type(value) ~= "table" then
+        return value
+    end
+    local kind = value.__realm
+    if kind == "object" then
+        local handle = native.realm_object_from_thread_safe_reference(realm._handle, value.ref)
+        return RealmObject._new(realm, realm._schema[value.class], nil, handle)
+    elseif kind == "results" then
+        local handle = native.realm_results_from_thread_safe_reference(realm._handle, value.ref)
+        return RealmResults._new(realm, handle, realm._schema[value.class])
+    elseif kind == "query" then
+        return realm:prepare(value.class, value.queryString)
+    end
+    for key, entry in pairs(value) do
+        value[key] = _unpack(realm, entry)
+    end
+
+    return value
+end
+
+---Open the realm of a worker and get the function running its tasks. Called
+---by the native pool in the Lua state of each worker thread.
+---@param config Realm.Config The configuration of the realm, without its functions and userdata.
+---@return fun(message: { task: string, args: table }): any
+function Workers._worker(config)
+    local loop = require "realm.scheduler.native"
+    local Realm = require "realm"
+    local realm = Realm.open(config)
+
+    return function(message)
+        -- Deliver the notifications of this realm and see the latest writes,
+        -- including those of the objects passed to the task.
+        loop.runOnce(0)
+        native.realm_refresh(realm._handle)
+        local task = assert(load(message.task, "=task", "b"))
+        local args = _unpack(realm, message.args)
+
+        return _pack((task(realm, table.unpack(args, 1, args.n or #args))))
+    end
+end
+
+---Run a task on a worker. The task gets the realm of the worker followed by
+---the arguments, and cannot capture local variables, as only its bytecode is
+---sent. The arguments and result can be nil, booleans, numbers, strings,
+---objects, results, queries and tables of them.
+---@param task fun(realm: Realm, ...): any The task.
+---@param args any[]? The arguments of the task.
+---@param onDone fun(err: string?, result: any)? The callback called with the error or result on this thread.
+function Workers:run(task, args, onDone)
+    if self._pool == nil then
+        error("The workers have been closed")
+    end
+    local index = 1
+    while true do
+        local name = debug.getupvalue(task, index)
+        if name == nil then
+            break
+        elseif name ~= "_ENV" then
+            error("Tasks cannot capture local variables, pass '" .. name .. "' as an argument instead")
+        end
+        index = index + 1
+    end
+
+    local id = self._nextId
+    self._nextId = id + 1
+    self._pool:submit(id, { task = string.dump(task), args = _pack(args or {}) })
+    self._pending[id] = onDone or false
+end
+
+---Stop the workers, waiting for the tasks which are running. The callbacks of
+---the tasks which have not completed are called with an error.
+function Workers:close()
+    if self._pool == nil then
+        return
+    end
+    self._pool:close()
+    self._pool = nil
+    for id, onDone in pairs(self._pending) do
+        self._pending[id] = nil
+        if onDone then
+            onDone("The workers were closed before the task completed")
+        end
+    end
+end
+
+---Start workers opening the realm with the configuration of a realm.
+---@param realm Realm The realm opened with Realm.open, in which the results of the tasks are resolved.
+---@param options Realm.Workers.Options? The options of the pool.
+---@return Realm.Workers
+function Workers.new(realm, options)
+    if realm._config == nil then
+        error("Workers need a realm opened with Realm.open")
+    end
+    -- Functions and userdata, such as a migration or a scheduler, cannot be
+    -- sent to the workers, which use the native scheduler.
+    local config = {}
+    for key, value in pairs(realm._config) do
+        if type(value) ~= "function" and type(value) ~= "userdata" then
+            config[key] = value
+        end
+    end
+
+    local pending = {}
+    local function deliver(id, ok, result)
+        local onDone = pending[id]
+        pending[id] = nil
+        if ok then
+            native.realm_refresh(realm._handle)
+            ok, result = pcall(_unpack, realm, result)
+        end
+        if onDone then
+            if ok then
+                onDone(nil, result)
+            else
+                onDone(result)
+            end
+        elseif not ok then
+            error(result)
+        end
+    end
+
+    local resultScheduler = scheduler.defaultFactory(realm._config.priority)
+    local ok, pool = pcall(workersNative.create_pool, deliver, resultScheduler, options and options.threads,
+        package.path, package.cpath, config)
+    native.realm_release(resultScheduler)
+    if not ok then
+        error(pool)
+    end
+
+    return setmetatable({
+        _realm = realm,
+        _pool = pool,
+        _pending = pending,
+        _nextId = 1,
+    }, Workers)
+end
+
+return Workers
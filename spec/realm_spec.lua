@@ -75,7 +75,8 @@ local schema = {
             petDictionary = "Pet{}?",
             intDictionary = "int{}",
             petSet = "Pet<>",
-            stringSet = "string<>"
+            stringSet = "string<>",
+            avatar = "data?"
         }
     },
     {
@@ -214,6 +215,990 @@ describe("Realm Lua tests", function()
             assert.True(notificationReceived)
         end)
     end)
+    describe("accessing properties natively", function()
+        it("gives objects the metatable of their class", function()
+            assert.are.equal(getmetatable(testPerson), realm._schema.Person.metatable)
+        end)
+        it("rejects values of the wrong type", function()
+            assert.has_error(function()
+                realm:write(function()
+                    testPerson.age = "old"
+                end)
+            end)
+            assert.are.equal(type(testPerson.age), "number")
+        end)
+        it("rejects changes outside of a write transaction", function()
+            assert.has_error(function()
+                testPerson.name = "Outside"
+            end)
+            assert.are_not.equal(testPerson.name, "Outside")
+        end)
+        it("uses a single userdata per object", function()
+            local person = realm:objects("Person")[1]
+            assert.are.equal(type(person), "userdata")
+            assert.are.equal(person._realm, realm)
+            assert.are.equal(person.class, realm._schema.Person)
+            assert.is_nil(realm:objects("Person")[#realm:objects("Person") + 1])
+        end)
+    end)
+    describe("scoping handles", function()
+        it("releases the objects created within a scope", function()
+            local inner
+            local name = realm:scope(function()
+                inner = realm:objects("Person")[1]
+                return inner.name
+            end)
+            assert.are.equal(name, testPerson.name)
+            assert.has_error(function()
+                return inner.name
+            end)
+            assert.are.equal(testPerson.name, name)
+        end)
+        it("releases the handles of nested scopes", function()
+            local outer, inner
+            realm:scope(function()
+                outer = realm:objects("Person")
+                realm:scope(function()
+                    inner = realm:objects("Person")[1]
+                end)
+                assert.are.equal(#outer, #realm:objects("Person"))
+            end)
+            assert.has_error(function()
+                return inner.name
+            end)
+        end)
+        it("raises instead of reading released handles", function()
+            local inner, innerResults
+            realm:scope(function()
+                inner = realm:objects("Person")[1]
+                innerResults = realm:objects("Person")
+            end)
+            assert.is_false(realm:isValid(inner))
+            assert.has_error(function()
+                return inner.ints
+            end, "Invalid object")
+            assert.has_error(function()
+                return inner.petDictionary
+            end, "Invalid object")
+            assert.has_error(function()
+                return inner.petSet
+            end, "Invalid object")
+            assert.has_error(function()
+                inner:toTable()
+            end, "Invalid object")
+            assert.has_error(function()
+                inner:addListener(function() end)
+            end, "Invalid object")
+            assert.has_error(function()
+                realm:delete(inner)
+            end, "Invalid object")
+            assert.has_error(function()
+                return #innerResults
+            end, "Invalid results")
+            assert.has_error(function()
+                return innerResults[1]
+            end, "Invalid results")
+            assert.has_error(function()
+                innerResults:filter("age > 0")
+            end, "Invalid results")
+        end)
+        it("raises instead of reading released collections", function()
+            local ints
+            realm:scope(function()
+                ints = testPerson.ints
+            end)
+            assert.has_error(function()
+                return #ints
+            end, "Invalid list")
+            assert.has_error(function()
+                return ints[1]
+            end, "Invalid list")
+        end)
+        it("releases the handles when the callback fails", function()
+            local inner
+            assert.has_error(function()
+                realm:scope(function()
+                    inner = realm:objects("Person")[1]
+                    error("failure")
+                end)
+            end)
+            assert.has_error(function()
+                return inner.name
+            end)
+        end)
+    end)
+    describe("viewing strings and binaries", function()
+        it("reads a string without copying it", function()
+            local view = testPerson:view("name")
+            assert.are.equal(#view, #testPerson.name)
+            assert.are.equal(tostring(view), testPerson.name)
+            assert.are.equal(view:sub(2, 3), testPerson.name:sub(2, 3))
+            assert.are.equal(view:sub(-2), testPerson.name:sub(-2))
+            assert.is_true(view:equals(testPerson.name))
+            assert.is_true(view == testPerson:view("name"))
+            assert.is_true(view < testPerson.name .. "z")
+        end)
+        it("reads binaries with embedded zeros", function()
+            realm:write(function()
+                testPerson.avatar = "a\0b\0c"
+            end)
+            assert.are.equal(testPerson.avatar, "a\0b\0c")
+            local view = testPerson:view("avatar")
+            assert.are.equal(#view, 5)
+            assert.are.equal(view:sub(3), "b\0c")
+            realm:write(function()
+                testPerson.avatar = nil
+            end)
+            assert.is_nil(testPerson:view("avatar"))
+        end)
+        it("is invalidated by write transactions", function()
+            local view = testPerson:view("name")
+            realm:write(function()
+                assert.is_false(view:isValid())
+                assert.has_error(function()
+                    return #view
+                end)
+            end)
+            assert.is_false(view:isValid())
+        end)
+    end)
+    describe("streaming blobs", function()
+        local blob = string.rep("0123456789", 10) .. "\0end"
+        it("writes chunks from a table and a function", function()
+            realm:write(function()
+                testPerson:writeBlob("avatar", { string.rep("0123456789", 10), "\0", "end" })
+            end)
+            assert.are.equal(testPerson.avatar, blob)
+            local chunks = { "a", "b\0", "c" }
+            local index = 0
+            realm:write(function()
+                testPerson:writeBlob("avatar", function()
+                    index = index + 1
+                    return chunks[index]
+                end)
+            end)
+            assert.are.equal(testPerson.avatar, "ab\0c")
+        end)
+        it("reads slices", function()
+            realm:write(function()
+                testPerson.avatar = blob
+            end)
+            local bytes, size = testPerson:readBlob("avatar", 10, 5)
+            assert.are.equal(bytes, "01234")
+            assert.are.equal(size, #blob)
+            assert.are.equal(testPerson:readBlob("avatar", 100, 10), "\0end")
+            assert.are.equal(testPerson:readBlob("avatar", 200, 10), "")
+            realm:write(function()
+                testPerson.avatar = nil
+            end)
+            assert.is_nil(testPerson:readBlob("avatar", 0, 10))
+        end)
+        it("reads and pipes fixed-size chunks", function()
+            realm:write(function()
+                testPerson.avatar = blob
+            end)
+            local reader = testPerson:blobReader("avatar", 16)
+            local chunks = {}
+            for chunk in reader.read, reader do
+                assert.is_true(#chunk <= 16)
+                table.insert(chunks, chunk)
+            end
+            assert.are.equal(table.concat(chunks), blob)
+
+            local written = {}
+            local stream = {
+                write = function(_, data, callback)
+                    table.insert(written, data)
+                    callback(nil)
+                end,
+            }
+            local done = false
+            testPerson:blobReader("avatar", 32):pipe(stream, function(err)
+                assert.is_nil(err)
+                done = true
+            end)
+            assert.is_true(done)
+            assert.are.equal(table.concat(written), blob)
+        end)
+        it("rejects properties that are not binary", function()
+            assert.has_error(function()
+                testPerson:readBlob("name", 0, 10)
+            end)
+        end)
+    end)
+    describe("reading collection changes", function()
+        it("reads indices and ranges lazily within the listener", function()
+            local insertions, ranges, keptChanges
+            local pets = realm:objects("Pet")
+            local numPets = #pets
+            -- Release the listener once done.
+            realm:scope(function()
+                pets:addListener(function (collection, changes)
+                    if #changes.insertions == 3 then
+                        insertions = {}
+                        for _, index in ipairs(changes.insertions) do
+                            table.insert(insertions, index)
+                        end
+                        ranges = {}
+                        for first, last in changes:insertionRanges() do
+                            table.insert(ranges, { first, last })
+                        end
+                        assert.are.equal(#changes.deletions, 0)
+                        assert.is_nil(changes.insertions[4])
+                        keptChanges = changes
+                        uv.stop()
+                    end
+                end)
+
+                post(function ()
+                    local otherRealm <close> = Realm.open({path = path, schemaVersion = 0, schema = schema, _cached = false})
+                    otherRealm:write(function()
+                        for _ = 1, 3 do
+                            otherRealm:create("Pet", { name = "Rex", category = "Puppy" })
+                        end
+                    end)
+                end)
+
+                local timer = timeout(1000)
+                uv.run()
+                timer:stop()
+                timer:close()
+            end)
+
+            assert.are.same(insertions, { numPets + 1, numPets + 2, numPets + 3 })
+            assert.are.same(ranges, { { numPets + 1, numPets + 3 } })
+            assert.has_error(function()
+                return keptChanges.insertions
+            end)
+            local puppies = {}
+            for _, pet in realm:objects("Pet"):filter("category = $0", "Puppy"):iter() do
+                table.insert(puppies, pet)
+            end
+            _delete(realm, puppies)
+        end)
+    end)
+    describe("filtering changes by key paths", function()
+        it("only notifies of changes to the given properties", function()
+            local modifications = 0
+            local age = testPerson.age + 1
+            realm:scope(function()
+                testPerson:addListener(function (object, changes)
+                    if #changes.modifiedProperties > 0 then
+                        modifications = modifications + 1
+                    end
+                    if object.age == age then
+                        uv.stop()
+                    end
+                end, { "age" })
+
+                post(function ()
+                    local otherRealm <close> = Realm.open({path = path, schemaVersion = 0, schema = schema, _cached = false})
+                    local otherPerson = otherRealm:objects("Person"):filter("name = $0", testPerson.name)[1]
+                    otherRealm:write(function()
+                        otherPerson.intDictionary.unrelated = 1
+                    end)
+                    otherRealm:write(function()
+                        otherPerson.age = age
+                    end)
+                end)
+
+                local timer = timeout(1000)
+                uv.run()
+                timer:stop()
+                timer:close()
+            end)
+
+            assert.are.equal(modifications, 1)
+        end)
+        it("rejects unknown properties", function()
+            assert.has_error(function()
+                testPerson:addListener(function() end, { "unknown" })
+            end)
+        end)
+    end)
+    describe("limiting the rate of changes", function()
+        it("merges the changes received in between notifications", function()
+            local pets = realm:objects("Pet")
+            local numPets = #pets
+            local notifications, insertions = 0, 0
+            realm:scope(function()
+                pets:addListener(function (collection, changes)
+                    if #changes.insertions > 0 then
+                        notifications = notifications + 1
+                        insertions = insertions + #changes.insertions
+                    end
+                    if #collection == numPets + 5 then
+                        uv.stop()
+                    end
+                end, nil, { maxRate = 5 })
+
+                post(function ()
+                    local otherRealm <close> = Realm.open({path = path, schemaVersion = 0, schema = schema, _cached = false})
+                    for _ = 1, 5 do
+                        otherRealm:write(function()
+                            otherRealm:create("Pet", { name = "Rex", category = "Storm" })
+                        end)
+                    end
+                end)
+
+                local timer = timeout(2000)
+                uv.run()
+                timer:stop()
+                timer:close()
+            end)
+
+            assert.are.equal(insertions, 5)
+            assert.is_true(notifications < 5)
+            local storm = {}
+            for _, pet in realm:objects("Pet"):filter("category = $0", "Storm"):iter() do
+                table.insert(storm, pet)
+            end
+            _delete(realm, storm)
+        end)
+        it("keeps the indices of modifications shifted by insertions", function()
+            local pets = realm:objects("Pet"):filter("category = $0", "Shift"):sorted("name")
+            local shifted
+            realm:write(function()
+                shifted = realm:create("Pet", { name = "M", category = "Shift" })
+            end)
+            local insertions, modificationsOld, modificationsNew
+            realm:scope(function()
+                pets:addListener(function (_, changes)
+                    if #changes.insertions > 0 then
+                        insertions = { table.unpack(changes.insertions) }
+                        modificationsOld = { table.unpack(changes.modificationsOld) }
+                        modificationsNew = { table.unpack(changes.modificationsNew) }
+                        uv.stop()
+                    end
+                end, nil, { coalesce = true })
+
+                post(function ()
+                    local otherRealm <close> = Realm.open({path = path, schemaVersion = 0, schema = schema, _cached = false})
+                    local otherPet = otherRealm:objects("Pet"):filter("category = $0", "Shift")[1]
+                    otherRealm:write(function()
+                        otherRealm:create("Pet", { name = "A", category = "Shift" })
+                        otherPet.name = "N"
+                    end)
+                end)
+
+                local timer = timeout(1000)
+                uv.run()
+                timer:stop()
+                timer:close()
+            end)
+
+            assert.are.same(insertions, { 1 })
+            assert.are.same(modificationsOld, { 1 })
+            assert.are.same(modificationsNew, { 2 })
+            _delete(realm, { shifted, pets[1] })
+        end)
+        it("rejects a rate that is not positive", function()
+            assert.has_error(function()
+                realm:objects("Pet"):addListener(function() end, nil, { maxRate = 0 })
+            end)
+        end)
+    end)
+    describe("prioritizing the work of realms", function()
+        it("delivers the notifications of background realms within the budget", function()
+            local libuv = require "realm.scheduler.libuv"
+            local budget = libuv.budget
+            libuv.budget = 0.001
+            local backgroundRealm <close> = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, priority = "background" })
+            local notified = false
+            backgroundRealm:scope(function()
+                backgroundRealm:objects("Person"):addListener(function()
+                    notified = true
+                    uv.stop()
+                end)
+                local timer = timeout(1000)
+                uv.run()
+                timer:stop()
+                timer:close()
+            end)
+            libuv.budget = budget
+
+            assert.is_true(notified)
+        end)
+        it("rejects unknown priorities", function()
+            assert.has_error(function()
+                Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, priority = "urgent" })
+            end)
+        end)
+    end)
+    describe("running the native scheduler", function()
+        it("delivers notifications without luv", function()
+            local scheduler = require "realm.scheduler"
+            local defaultFactory, timer = scheduler.defaultFactory, scheduler.timer
+            local loop = require "realm.scheduler.native"
+            assert.is_number(loop.fd())
+
+            local notified = false
+            do
+                local nativeRealm <close> = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false })
+                nativeRealm:scope(function()
+                    nativeRealm:objects("Person"):addListener(function()
+                        notified = true
+                        loop.stop()
+                    end)
+                    loop.run()
+                end)
+            end
+            scheduler.defaultFactory, scheduler.timer = defaultFactory, timer
+
+            assert.is_true(notified)
+        end)
+    end)
+    describe("writing asynchronously", function()
+        it("commits the changes in the background", function()
+            local committed, commitError = false, nil
+            realm:writeAsync(function()
+                realm:create("Pet", { name = "Async", category = "Later" })
+            end, function(err)
+                committed, commitError = true, err
+                uv.stop()
+            end)
+
+            local timer = timeout(1000)
+            uv.run()
+            timer:stop()
+            timer:close()
+
+            assert.is_true(committed)
+            assert.is_nil(commitError)
+            local pet = realm:objects("Pet"):filter("category = $0", "Later")[1]
+            assert.are.equal(pet.name, "Async")
+            _delete(realm, { pet })
+        end)
+        it("cancels the changes if the write fails", function()
+            local numPets = #realm:objects("Pet")
+            local commitError
+            realm:writeAsync(function()
+                realm:create("Pet", { name = "Async", category = "Never" })
+                error("failed")
+            end, function(err)
+                commitError = err
+                uv.stop()
+            end)
+
+            local timer = timeout(1000)
+            uv.run()
+            timer:stop()
+            timer:close()
+
+            assert.is_truthy(commitError:find("failed"))
+            assert.are.equal(#realm:objects("Pet"), numPets)
+        end)
+    end)
+    describe("grouping commits", function()
+        it("applies the writes queued within a tick in one transaction", function()
+            local groupedRealm = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, groupCommit = true })
+            local numPets = #realm:objects("Pet")
+            local outcomes = {}
+            local function onCommitted(index)
+                return function(err, result)
+                    outcomes[index] = { err = err, result = result }
+                    if #outcomes == 3 then
+                        uv.stop()
+                    end
+                end
+            end
+            groupedRealm:write(function()
+                groupedRealm:create("Pet", { name = "Group1", category = "Grouped" })
+                return 1
+            end, onCommitted(1))
+            groupedRealm:write(function()
+                groupedRealm:create("Pet", { name = "Group2", category = "Grouped" })
+                error("failed")
+            end, onCommitted(2))
+            groupedRealm:write(function()
+                groupedRealm:create("Pet", { name = "Group3", category = "Grouped" })
+                return 3
+            end, onCommitted(3))
+            assert.are.equal(#groupedRealm:objects("Pet"), numPets)
+
+            local timer = timeout(1000)
+            uv.run()
+            timer:stop()
+            timer:close()
+
+            assert.are.equal(outcomes[1].result, 1)
+            assert.is_truthy(outcomes[2].err:find("failed"))
+            assert.are.equal(outcomes[3].result, 3)
+            local grouped = {}
+            for _, pet in groupedRealm:objects("Pet"):filter("category = $0", "Grouped"):iter() do
+                table.insert(grouped, pet.name)
+            end
+            table.sort(grouped)
+            assert.are.same(grouped, { "Group1", "Group3" })
+            -- Closing the realm applies the writes still queued.
+            groupedRealm:write(function()
+                local pets = {}
+                for _, pet in groupedRealm:objects("Pet"):filter("category = $0", "Grouped"):iter() do
+                    table.insert(pets, pet)
+                end
+                for _, pet in ipairs(pets) do
+                    groupedRealm:delete(pet)
+                end
+            end)
+            groupedRealm:close()
+            local checkRealm <close> = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false })
+            assert.are.equal(#checkRealm:objects("Pet"), numPets)
+        end)
+        it("notifies every queued write when a callback raises", function()
+            local groupedRealm <close> = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, groupCommit = true })
+            local notified = {}
+            groupedRealm:write(function() return 1 end, function()
+                table.insert(notified, 1)
+                error("callback failed")
+            end)
+            groupedRealm:write(function() return 2 end, function()
+                table.insert(notified, 2)
+            end)
+            assert.has_error(function() groupedRealm:close() end)
+            assert.are.same(notified, { 1, 2 })
+            -- The realm is closed even though a callback raised.
+            assert.has_error(function() return groupedRealm:objects("Pet")[1] end)
+        end)
+        it("raises the error of a failed write without onCommitted", function()
+            local groupedRealm <close> = Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, groupCommit = true })
+            groupedRealm:write(function() error("unreported") end)
+            local ok, err = pcall(groupedRealm.close, groupedRealm)
+            assert.is_false(ok)
+            assert.is_truthy(err:find("unreported"))
+        end)
+    end)
+    describe("relaxing durability", function()
+        it("keeps in-memory realms out of the file", function()
+            local memoryPath = path .. ".memory"
+            do
+                local memoryRealm <close> = Realm.open({ path = memoryPath, schemaVersion = 0, schema = schema, _cached = false, inMemory = true })
+                memoryRealm:write(function()
+                    memoryRealm:create("Pet", { name = "Cache", category = "Memory" })
+                end)
+                assert.are.equal(#memoryRealm:objects("Pet"), 1)
+            end
+            local memoryRealm <close> = Realm.open({ path = memoryPath, schemaVersion = 0, schema = schema, _cached = false, durability = "memOnly" })
+            assert.are.equal(#memoryRealm:objects("Pet"), 0)
+        end)
+        it("rejects unknown durabilities", function()
+            assert.has_error(function()
+                Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, durability = "sometimes" })
+            end)
+        end)
+        it("only disables syncing to disk for the whole process explicitly", function()
+            assert.has_error(function()
+                Realm.open({ path = path, schemaVersion = 0, schema = schema, _cached = false, durability = "unsafe" })
+            end)
+        end)
+    end)
+    describe("freezing snapshots", function()
+        it("keeps the values of frozen objects", function()
+            local frozenPerson, frozen = testPerson:freeze()
+            local name = testPerson.name
+            realm:write(function()
+                testPerson.name = name .. " Jr."
+            end)
+            assert.are.equal(frozenPerson.name, name)
+            assert.are.equal(testPerson.name, name .. " Jr.")
+            realm:write(function()
+                testPerson.name = name
+            end)
+            frozen:close()
+        end)
+        it("keeps the count of frozen results", function()
+            local results = realm:objects("Pet")
+            local frozenResults, frozen = results:freeze()
+            local count = #frozenResults
+            realm:write(function()
+                realm:create("Pet", { name = "Snapshot", category = "Frozen" })
+            end)
+            assert.are.equal(#frozenResults, count)
+            assert.are.equal(#results, count + 1)
+            frozen:close()
+            _delete(realm, { results:filter("name = $0", "Snapshot")[1] })
+        end)
+        it("resolves results and objects in a shared frozen realm", function()
+            local frozen <close> = realm:freeze()
+            local frozenResults, resultsRealm = realm:objects("Pet"):freeze(frozen)
+            local frozenPerson, personRealm = testPerson:freeze(frozen)
+            assert.are.equal(resultsRealm, frozen)
+            assert.are.equal(personRealm, frozen)
+            assert.are.equal(#frozenResults, #realm:objects("Pet"))
+            assert.are.equal(frozenPerson.name, testPerson.name)
+        end)
+        it("cannot write to frozen realms", function()
+            local frozen <close> = realm:freeze()
+            assert.has_error(function()
+                frozen:write(function()
+                    frozen:create("Pet", { name = "Frozen", category = "Frozen" })
+                end)
+            end)
+        end)
+        it("shares frozen realms with other Lua states", function()
+            local frozen <close> = realm:freeze()
+            local token = frozen:exportFrozen()
+            local imported <close> = Realm.importFrozen(token)
+            assert.are.equal(#imported:objects("Person"), #frozen:objects("Person"))
+            assert.has_error(function()
+                Realm.importFrozen(token)
+            end)
+            assert.has_error(function()
+                realm:exportFrozen()
+            end)
+            assert.has_error(function()
+                Realm.importFrozen(frozen._handle)
+            end)
+        end)
+    end)
+    describe("running tasks on workers", function()
+        local Workers = require "realm.workers"
+
+        ---Run a task on a single worker and wait for its error and result.
+        local function runTask(task, args)
+            local workers <close> = Workers.new(realm, { threads = 1 })
+            local done, taskError, taskResult = false, nil, nil
+            workers:run(task, args, function(err, result)
+                done, taskError, taskResult = true, err, result
+                uv.stop()
+            end)
+
+            local timer = timeout(5000)
+            uv.run()
+            timer:stop()
+            timer:close()
+
+            assert.is_true(done)
+            return taskError, taskResult
+        end
+
+        it("passes objects to and from the workers", function()
+            local err, result = runTask(function(workerRealm, person, suffix)
+                return { name = person.name .. suffix, person = person, people = workerRealm:objects("Person") }
+            end, { testPerson, "!" })
+            assert.is_nil(err)
+            assert.are.equal(result.name, testPerson.name .. "!")
+            assert.are.equal(result.person.name, testPerson.name)
+            assert.are.equal(#result.people, #realm:objects("Person"))
+        end)
+        it("passes frozen realms to the workers", function()
+            local frozen <close> = realm:freeze()
+            local err, count = runTask(function(_, token)
+                local imported <close> = require("realm").importFrozen(token)
+                return #imported:objects("Person")
+            end, { frozen:exportFrozen() })
+            assert.is_nil(err)
+            assert.are.equal(count, #frozen:objects("Person"))
+        end)
+        it("reports the errors of tasks", function()
+            local err = runTask(function()
+                error("failed")
+            end)
+            assert.is_truthy(err:find("failed"))
+        end)
+        it("rejects arguments which cannot be sent", function()
+            local workers <close> = Workers.new(realm, { threads = 1 })
+            assert.has_error(function()
+                workers:run(function() end, { testPerson, print })
+            end)
+            local timer = uv.new_timer()
+            assert.has_error(function()
+                workers:run(function() end, { timer })
+            end)
+            timer:close()
+        end)
+        it("rejects tasks capturing local variables", function()
+            local workers <close> = Workers.new(realm, { threads = 1 })
+            local captured = 1
+            assert.has_error(function()
+                workers:run(function()
+                    return captured
+                end)
+            end)
+        end)
+    end)
+    describe("importing files", function()
+        local importPath
+
+        ---@param contents string
+        local function writeFile(contents)
+            importPath = path .. ".import"
+            local file = assert(io.open(importPath, "w"))
+            file:write(contents)
+            file:close()
+        end
+
+        after_each(function()
+            os.remove(importPath)
+        end)
+
+        it("imports NDJSON records", function()
+            writeFile('{"name": "Imported \\"One\\"", "age": 1}\n\n{"age": 2, "name": "Imported \\u00e9"}\n')
+            local count = realm:import(importPath, "PersonWithPK", { format = "ndjson", batchSize = 1, threads = 2 })
+            assert.are.equal(count, 2)
+            local people = realm:objects("PersonWithPK"):filter("name BEGINSWITH $0", "Imported")
+            assert.are.equal(#people, 2)
+            assert.are.equal(people:filter("age = 1")[1].name, 'Imported "One"')
+            assert.are.equal(people:filter("age = 2")[1].name, "Imported é")
+            _delete(realm, { people[1], people[2] })
+        end)
+        it("imports CSV records", function()
+            writeFile('category,name\r\nImported,"Multi\nline"\r\nImported,"Quoted, ""twice"""\r\n')
+            local count = realm:import(importPath, "Pet", { format = "csv" })
+            assert.are.equal(count, 2)
+            local pets = realm:objects("Pet"):filter("category = $0", "Imported")
+            assert.are.equal(#pets:filter("name = $0", "Multi\nline"), 1)
+            assert.are.equal(#pets:filter("name = $0", 'Quoted, "twice"'), 1)
+            _delete(realm, { pets[1], pets[2] })
+        end)
+        it("imports short CSV records in separate batches", function()
+            writeFile('name,category\nAl,Short\nBo,Short\n')
+            local count = realm:import(importPath, "Pet", { format = "csv", batchSize = 1 })
+            assert.are.equal(count, 2)
+            local pets = realm:objects("Pet"):filter("category = $0", "Short")
+            assert.are.equal(#pets:filter("name = $0", "Al"), 1)
+            assert.are.equal(#pets:filter("name = $0", "Bo"), 1)
+            _delete(realm, { pets[1], pets[2] })
+        end)
+        it("reports the record which could not be imported", function()
+            writeFile('{"name": "Imported", "age": 1}\n{"name": "Invalid", "age": "old"}\n{"name": "Skipped", "age": 3}\n')
+            local ok, err = pcall(realm.import, realm, importPath, "PersonWithPK", { format = "ndjson", batchSize = 1, threads = 3 })
+            assert.is_false(ok)
+            assert.is_truthy(err:find("record 2"))
+            -- The batches before the failing one are written, and none after it.
+            local imported = realm:objects("PersonWithPK"):filter("name = $0", "Imported")
+            assert.are.equal(#imported, 1)
+            assert.are.equal(#realm:objects("PersonWithPK"):filter("name = $0", "Skipped"), 0)
+            _delete(realm, { imported[1] })
+        end)
+    end)
+    describe("converting objects to tables", function()
+        it("reads all properties", function()
+            local values = testPerson:toTable()
+            assert.are.equal(values.name, testPerson.name)
+            assert.are.equal(values.age, testPerson.age)
+            assert.are.equal(#values.ints, #testPerson.ints)
+        end)
+        it("reads only the requested properties", function()
+            local values = testPerson:toTable({ "name" })
+            assert.are.equal(values.name, testPerson.name)
+            assert.are.equal(values.age, nil)
+        end)
+        it("raises on unknown properties", function()
+            assert.has_error(function() testPerson:toTable({ "name", "unknown" }) end)
+        end)
+        it("wraps references as objects", function()
+            local testPet
+            realm:write(function()
+                testPet = realm:create("Pet", { name = "Oreo", category = "Cat" })
+                testPerson.pet = testPet
+            end)
+            local values = testPerson:toTable({ "pet" })
+            assert.are.equal(values.pet.name, "Oreo")
+            _delete(realm, {testPet})
+        end)
+    end)
+    describe("creating many objects", function()
+        it("creates all rows", function()
+            local numPets = #realm:objects("Pet")
+            realm:write(function()
+                realm:createMany("Pet", {
+                    { name = "Bulk1", category = "Fish" },
+                    { name = "Bulk2", category = "Fish" },
+                })
+            end)
+            assert.is.equal(#realm:objects("Pet"), numPets + 2)
+            _delete(realm, { realm:objects("Pet"):filter("category = $0", "Fish")[1] })
+            _delete(realm, { realm:objects("Pet"):filter("category = $0", "Fish")[1] })
+        end)
+        it("returns the created objects when requested", function()
+            local pets
+            realm:write(function()
+                assert.is_nil(realm:createMany("Pet", { { name = "Bulk3" } }))
+                pets = realm:createMany("Pet", { { name = "Bulk4" }, { name = "Bulk5" } }, true)
+            end)
+            assert.is.equal(#pets, 2)
+            assert.is.equal(pets[2].name, "Bulk5")
+            _delete(realm, { pets[1], pets[2], realm:objects("Pet"):filter("name = $0", "Bulk3")[1] })
+        end)
+        it("sets primary keys and collections", function()
+            local people
+            realm:write(function()
+                people = realm:createMany("PersonWithPK", { { name = "BulkPK", age = 7 } }, true)
+            end)
+            assert.is.equal(people[1].age, 7)
+            local person
+            realm:write(function()
+                person = realm:createMany("Person", { { name = "BulkList", ints = { 1, 2, 3 } } }, true)[1]
+            end)
+            assert.is.equal(#person.ints, 3)
+            _delete(realm, { people[1], person })
+        end)
+        it("raises on invalid rows without creating them", function()
+            local numPets = #realm:objects("Pet")
+            assert.has_error(function()
+                realm:write(function()
+                    realm:createMany("Pet", { { name = "BulkBad", category = function() end } })
+                end)
+            end)
+            assert.has_error(function()
+                realm:write(function()
+                    realm:createMany("Person", { { name = "BulkBad", ints = { 1, {} } } })
+                end)
+            end)
+            assert.is.equal(#realm:objects("Pet"), numPets)
+            assert.is.equal(#realm:objects("Person"):filter("name = $0", "BulkBad"), 0)
+        end)
+    end)
+    describe("iterating results", function()
+        local pets
+        setup(function()
+            realm:write(function()
+                pets = realm:createMany("Pet", {
+                    { name = "Iter1", category = "Iter" },
+                    { name = "Iter2", category = "Iter" },
+                    { name = "Iter3", category = "Iter" },
+                }, true)
+            end)
+        end)
+        teardown(function() _delete(realm, pets) end)
+
+        it("visits every object with pairs", function()
+            local results = realm:objects("Pet"):filter("category = $0", "Iter")
+            local names = {}
+            for index, pet in pairs(results) do
+                names[index] = pet.name
+            end
+            assert.are.same(names, { results[1].name, results[2].name, results[3].name })
+        end)
+        it("visits every object in chunks", function()
+            local results = realm:objects("Pet"):filter("category = $0", "Iter")
+            local count = 0
+            for _, pet in results:iter(2) do
+                assert.are.equal(pet.category, "Iter")
+                count = count + 1
+            end
+            assert.are.equal(count, 3)
+        end)
+    end)
+    describe("reading columns of results", function()
+        it("returns the values of every object", function()
+            local people = realm:objects("Person")
+            local ages, count = people:column("age")
+            assert.are.equal(count, #people)
+            for index = 1, count do
+                assert.are.equal(ages[index], people[index].age)
+            end
+        end)
+        it("leaves holes for null references", function()
+            local people = realm:objects("Person")
+            local pets, count = people:column("pet")
+            assert.are.equal(count, #people)
+            for index = 1, count do
+                assert.are.equal(pets[index] == nil, people[index].pet == nil)
+            end
+        end)
+    end)
+    describe("aggregating results", function()
+        local people
+        setup(function()
+            realm:write(function()
+                people = realm:createMany("PersonWithPK", {
+                    { name = "Aggregate1", age = 10 },
+                    { name = "Aggregate2", age = 20 },
+                    { name = "Aggregate3", age = 60 },
+                }, true)
+            end)
+        end)
+        teardown(function() _delete(realm, people) end)
+
+        it("computes sum, min, max and average", function()
+            local results = realm:objects("PersonWithPK"):filter("name BEGINSWITH $0", "Aggregate")
+            assert.are.equal(results:sum("age"), 90)
+            assert.are.equal(results:min("age"), 10)
+            assert.are.equal(results:max("age"), 60)
+            assert.are.equal(results:average("age"), 30)
+        end)
+        it("handles empty results", function()
+            local results = realm:objects("PersonWithPK"):filter("name = $0", "Nobody")
+            assert.are.equal(results:sum("age"), 0)
+            assert.is_nil(results:min("age"))
+            assert.is_nil(results:average("age"))
+        end)
+    end)
+    describe("sorting and limiting results", function()
+        local people
+        setup(function()
+            realm:write(function()
+                people = realm:createMany("PersonWithPK", {
+                    { name = "Sort1", age = 30 },
+                    { name = "Sort2", age = 10 },
+                    { name = "Sort3", age = 20 },
+                    { name = "Sort4", age = 10 },
+                }, true)
+            end)
+        end)
+        teardown(function() _delete(realm, people) end)
+
+        local function sortPeople()
+            return realm:objects("PersonWithPK"):filter("name BEGINSWITH $0", "Sort")
+        end
+
+        it("sorts in ascending and descending order", function()
+            local ascending = sortPeople():sorted("age")
+            assert.are.equal(ascending[1].age, 10)
+            assert.are.equal(ascending[4].age, 30)
+            local descending = sortPeople():sorted({ "age", "name" }, { false, true })
+            assert.are.equal(descending[1].name, "Sort1")
+            assert.are.equal(descending[3].name, "Sort2")
+        end)
+        it("keeps distinct values", function()
+            assert.are.equal(#sortPeople():distinct("age"), 3)
+        end)
+        it("limits the number of objects", function()
+            local page = sortPeople():sorted("age", false):limit(2)
+            assert.are.equal(#page, 2)
+            assert.are.equal(page[2].name, "Sort3")
+        end)
+    end)
+    describe("prepared queries", function()
+        local people
+        setup(function()
+            realm:write(function()
+                people = realm:createMany("PersonWithPK", {
+                    { name = "Prepared1", age = 10 },
+                    { name = "Prepared2", age = 20 },
+                    { name = "Prepared3", age = 30 },
+                }, true)
+            end)
+        end)
+        teardown(function() _delete(realm, people) end)
+
+        it("runs with different arguments", function()
+            local query = realm:prepare("PersonWithPK", "name BEGINSWITH $0 AND age > $1")
+            assert.are.equal(#query:run("Prepared", 0), 3)
+            assert.are.equal(#query:run("Prepared", 15), 2)
+            assert.are.equal(#query:run("Prepared", 0), 3)
+            assert.are.equal(query:run("Prepared", 25)[1].name, "Prepared3")
+        end)
+        it("matches filtering results", function()
+            local query = realm:prepare("PersonWithPK", "age >= $0")
+            local filtered = realm:objects("PersonWithPK"):filter("age >= $0", 20)
+            assert.are.equal(#query:run(20), #filtered)
+        end)
+        it("raises errors when prepared", function()
+            assert.has_error(function()
+                realm:prepare("PersonWithPK", "unknown > $0")
+            end)
+            assert.has_error(function()
+                realm:prepare("PersonWithPK", "age >")
+            end)
+        end)
+        it("runs queries without arguments", function()
+            local query = realm:prepare("PersonWithPK", "name == 'Prepared$1'")
+            assert.are.equal(#query:run(), 0)
+            assert.are.equal(#query:run(), 0)
+        end)
+    end)
     describe("with lists", function()
         local testPetA
         local testPetB
@@ -0,0 +1,387 @@
+#include <new>
+#include <optional>
+#include <vector>
+#include <lua.hpp>
+
+#include <realm/object-store/c_api/types.hpp>
+#include <realm/object-store/c_api/conversion.hpp>
+
+#include "realm_accessors.hpp"
+#include "realm_util.hpp"
+
+// Getting and setting a single value of a specific type, with the type
+// resolved when the class metatable is created rather than on every access.
+using Getter = void (*)(lua_State* L, const realm::Obj& object, realm::ColKey column);
+using Setter = void (*)(lua_State* L, realm::Obj& object, realm::ColKey column, int value_index);
+using Check = bool (*)(lua_State* L, int value_index);
+
+struct PropertyAccessor {
+    realm::ColKey column;
+    const char* type_name;
+    Getter get;
+    Setter set;
+    Check check;
+};
+
+static void push_value(lua_State* L, int64_t value) {
+    lua_pushinteger(L, value);
+}
+
+static void push_value(lua_State* L, bool value) {
+    lua_pushboolean(L, value);
+}
+
+static void push_value(lua_State* L, float value) {
+    lua_pushnumber(L, value);
+}
+
+static void push_value(lua_State* L, double value) {
+    lua_pushnumber(L, value);
+}
+
+static void push_value(lua_State* L, realm::StringData value) {
+    if (value.is_null()) {
+        lua_pushnil(L);
+        return;
+    }
+    lua_pushlstring(L, value.data(), value.size());
+}
+
+static void push_value(lua_State* L, realm::BinaryData value) {
+    if (value.is_null()) {
+        lua_pushnil(L);
+        return;
+    }
+    lua_pushlstring(L, value.data(), value.size());
+}
+
+template <typename T>
+static void push_value(lua_State* L, const realm::util::Optional<T>& value) {
+    if (!value) {
+        lua_pushnil(L);
+        return;
+    }
+    push_value(L, *value);
+}
+
+template <typename T>
+static T to_value(lua_State* L, int index);
+
+template <>
+int64_t to_value<int64_t>(lua_State* L, int index) {
+    return lua_tointeger(L, index);
+}
+
+template <>
+bool to_value<bool>(lua_State* L, int index) {
+    return lua_toboolean(L, index);
+}
+
+template <>
+float to_value<float>(lua_State* L, int index) {
+    return static_cast<float>(lua_tonumber(L, index));
+}
+
+template <>
+double to_value<double>(lua_State* L, int index) {
+    return lua_tonumber(L, index);
+}
+
+template <>
+realm::StringData to_value<realm::StringData>(lua_State* L, int index) {
+    size_t size;
+    const char* data = lua_tolstring(L, index, &size);
+    return realm::StringData(data, size);
+}
+
+template <>
+realm::BinaryData to_value<realm::BinaryData>(lua_State* L, int index) {
+    size_t size;
+    const char* data = lua_tolstring(L, index, &size);
+    return realm::BinaryData(data, size);
+}
+
+static bool is_integer(lua_State* L, int index) {
+    return lua_isinteger(L, index);
+}
+
+static bool is_boolean(lua_State* L, int index) {
+    return lua_isboolean(L, index);
+}
+
+static bool is_number(lua_State* L, int index) {
+    return lua_type(L, index) == LUA_TNUMBER;
+}
+
+static bool is_string(lua_State* L, int index) {
+    return lua_type(L, index) == LUA_TSTRING;
+}
+
+// Nullable columns of primitive types are stored as optionals.
+template <typename Stored>
+static void get_property(lua_State* L, const realm::Obj& object, realm::ColKey column) {
+    push_value(L, object.get<Stored>(column));
+}
+
+template <typename T>
+static void set_property(lua_State* L, realm::Obj& object, realm::ColKey column, int value_index) {
+    if (lua_isnil(L, value_index)) {
+        object.set_null(column);
+        return;
+    }
+    object.set<T>(column, to_value<T>(L, value_index));
+}
+
+template <typename T>
+static PropertyAccessor typed_accessor(realm::ColKey column, bool nullable, const char* type_name, Check check) {
+    return PropertyAccessor {
+        .column = column,
+        .type_name = type_name,
+        .get = nullable ? get_property<realm::util::Optional<T>> : get_property<T>,
+        .set = set_property<T>,
+        .check = check,
+    };
+}
+
+// Get the accessor of single values of supported types.
+static std::optional<PropertyAccessor> make_accessor(const realm::Property& property) {
+    if (bool(property.type & realm::PropertyType::Collection)) {
+        return std::nullopt;
+    }
+    bool nullable = bool(property.type & realm::PropertyType::Nullable);
+    switch (realm::c_api::to_capi(property.type)) {
+        case RLM_PROPERTY_TYPE_INT:
+            return typed_accessor<int64_t>(property.column_key, nullable, "integer", is_integer);
+        case RLM_PROPERTY_TYPE_BOOL:
+            return typed_accessor<bool>(property.column_key, nullable, "boolean", is_boolean);
+        case RLM_PROPERTY_TYPE_FLOAT:
+            return typed_accessor<float>(property.column_key, nullable, "number", is_number);
+        case RLM_PROPERTY_TYPE_DOUBLE:
+            return typed_accessor<double>(property.column_key, nullable, "number", is_number);
+        case RLM_PROPERTY_TYPE_STRING:
+            // Null strings and binaries are told apart by the value itself.
+            return typed_accessor<realm::StringData>(property.column_key, false, "string", is_string);
+        case RLM_PROPERTY_TYPE_BINARY:
+            return typed_accessor<realm::BinaryData>(property.column_key, false, "string", is_string);
+        default:
+            return std::nullopt;
+    }
+}
+
+// Fields of every object, indexed below the accessors.
+enum ObjectField : lua_Integer {
+    RealmField = -1,
+    ClassField = -2,
+    HandleField = -3,
+};
+
+// Call the fallback (3rd upvalue) with the first num_args arguments.
+static int call_fallback(lua_State* L, int num_args, int num_results) {
+    lua_settop(L, num_args);
+    lua_pushvalue(L, lua_upvalueindex(3));
+    lua_insert(L, 1);
+    lua_call(L, num_args, num_results);
+
+    return num_results;
+}
+
+// Look up the index of the accessor or field of the property (2nd argument).
+static bool find_accessor_index(lua_State* L, lua_Integer& index) {
+    lua_pushvalue(L, 2);
+    bool found = lua_rawget(L, lua_upvalueindex(1)) == LUA_TNUMBER;
+    index = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+
+    return found;
+}
+
+static const PropertyAccessor& get_accessor(lua_State* L, lua_Integer index) {
+    auto* accessors = static_cast<const PropertyAccessor*>(lua_touserdata(L, lua_upvalueindex(2)));
+
+    return accessors[index];
+}
+
+// Push the object handle of the proxy (1st argument), cloning the object the
+// first time it is asked for.
+static int push_object_handle(lua_State* L, ObjectProxy* proxy) {
+    if (lua_getiuservalue(L, 1, 3) != LUA_TNIL) {
+        return 1;
+    }
+    lua_pop(L, 1);
+    if (!proxy->object()) {
+        return _inform_error(L, "Invalid object");
+    }
+
+    realm_object_t** handle = push_handle<realm_object_t>(L);
+    *handle = static_cast<realm_object_t*>(realm_clone(proxy->object()));
+
+    // Release the handle together with the other handles of the realm.
+    link_handle(&proxy->handle, reinterpret_cast<realm_lua_handle*>(handle));
+
+    lua_pushvalue(L, -1);
+    lua_setiuservalue(L, 1, 3);
+
+    return 1;
+}
+
+static int class_index(lua_State* L) {
+    lua_Integer index;
+    if (!find_accessor_index(L, index)) {
+        return call_fallback(L, 2, 1);
+    }
+    auto* proxy = static_cast<ObjectProxy*>(lua_touserdata(L, 1));
+    switch (index) {
+        case RealmField:
+            lua_getiuservalue(L, 1, 1);
+            return 1;
+        case ClassField:
+            lua_getiuservalue(L, 1, 2);
+            return 1;
+        case HandleField:
+            return push_object_handle(L, proxy);
+    }
+
+    const PropertyAccessor& accessor = get_accessor(L, index);
+    realm_object_t* object = proxy->object();
+    if (!object) {
+        return _inform_error(L, "Invalid object");
+    }
+    try {
+        object->verify_attached();
+        accessor.get(L, object->obj(), accessor.column);
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int class_newindex(lua_State* L) {
+    lua_Integer index;
+    if (!find_accessor_index(L, index)) {
+        return call_fallback(L, 3, 0);
+    }
+    if (index < 0) {
+        return _inform_error(L, "Cannot set '%1' of an object", lua_tostring(L, 2));
+    }
+    const PropertyAccessor& accessor = get_accessor(L, index);
+    if (!lua_isnil(L, 3) && !accessor.check(L, 3)) {
+        return _inform_error(L, "Property '%1' expects a %2 value, got %3", lua_tostring(L, 2), accessor.type_name, luaL_typename(L, 3));
+    }
+    realm_object_t* object = static_cast<ObjectProxy*>(lua_touserdata(L, 1))->object();
+    if (!object) {
+        return _inform_error(L, "Invalid object");
+    }
+    try {
+        object->get_realm()->verify_in_write();
+        object->verify_attached();
+        realm::Obj obj = object->obj();
+        accessor.set(L, obj, accessor.column, 3);
+        return 0;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int class_gc(lua_State* L) {
+    auto* proxy = static_cast<ObjectProxy*>(lua_touserdata(L, 1));
+    release_handle(&proxy->handle);
+
+    return 0;
+}
+
+void _push_class_metatable(lua_State* L, const realm::ObjectSchema& class_info, int object_table) {
+    object_table = lua_absindex(L, object_table);
+
+    std::vector<std::pair<const char*, PropertyAccessor>> accessors;
+    for (const realm::Property& property : class_info.persisted_properties) {
+        if (std::optional<PropertyAccessor> accessor = make_accessor(property)) {
+            accessors.emplace_back(property.name.c_str(), *accessor);
+        }
+    }
+
+    lua_createtable(L, 0, 4);
+
+    // Create the upvalues shared by __index and __newindex: the index of
+    // every property name and object field (interned by Lua, so looking it
+    // up only hashes a pointer), the accessors and the fallback.
+    lua_createtable(L, 0, accessors.size() + 3);
+    auto* accessor_array = static_cast<PropertyAccessor*>(lua_newuserdatauv(L, sizeof(PropertyAccessor) * accessors.size(), 0));
+    for (size_t index = 0; index < accessors.size(); index++) {
+        new (&accessor_array[index]) PropertyAccessor(accessors[index].second);
+        lua_pushinteger(L, index);
+        lua_setfield(L, -3, accessors[index].first);
+    }
+    lua_pushinteger(L, RealmField);
+    lua_setfield(L, -3, "_realm");
+    lua_pushinteger(L, ClassField);
+    lua_setfield(L, -3, "class");
+    lua_pushinteger(L, HandleField);
+    lua_setfield(L, -3, "_handle");
+
+    lua_pushvalue(L, -2);
+    lua_pushvalue(L, -2);
+    lua_getfield(L, object_table, "__index");
+    lua_pushcclosure(L, class_index, 3);
+    lua_setfield(L, -4, "__index");
+
+    lua_getfield(L, object_table, "__newindex");
+    lua_pushcclosure(L, class_newindex, 3);
+    lua_setfield(L, -2, "__newindex");
+
+    lua_pushcfunction(L, class_gc);
+    lua_setfield(L, -2, "__gc");
+
+    lua_pushboolean(L, true);
+    lua_setfield(L, -2, "__realmObject");
+}
+
+bool _is_object_proxy(lua_State* L, int index) {
+    if (luaL_getmetafield(L, index, "__realmObject") == LUA_TNIL) {
+        return false;
+    }
+    lua_pop(L, 1);
+
+    return true;
+}
+
+void _push_object_proxy(lua_State* L, realm::Object object, int realm_index, int class_info_index) {
+    realm_index = lua_absindex(L, realm_index);
+    class_info_index = lua_absindex(L, class_info_index);
+
+    // Create and push the proxy onto the stack and set the metatable of its class.
+    auto* proxy = static_cast<ObjectProxy*>(lua_newuserdatauv(L, sizeof(ObjectProxy), 3));
+    new (proxy) ObjectProxy(std::move(object));
+    lua_getfield(L, class_info_index, "metatable");
+    lua_setmetatable(L, -2);
+
+    // Track the proxy by the realm so that the object is released with it.
+    lua_getfield(L, realm_index, "_handle");
+    link_handle(static_cast<realm_lua_handle*>(lua_touserdata(L, -1)), &proxy->handle);
+    lua_pop(L, 1);
+
+    lua_pushvalue(L, realm_index);
+    lua_setiuservalue(L, -2, 1);
+    lua_pushvalue(L, class_info_index);
+    lua_setiuservalue(L, -2, 2);
+}
+
+int lib_realm_object_to_proxy(lua_State* L) {
+    // Get the arguments from the stack.
+    auto** handle = static_cast<realm_object_t**>(luaL_checkudata(L, 1, RealmHandle));
+    if (!*handle) {
+        return _inform_error(L, "Invalid object");
+    }
+
+    // Move the object into the proxy, the handle is no longer needed.
+    realm::Object object(std::move(**handle));
+    release_handle(reinterpret_cast<realm_lua_handle*>(handle));
+    _push_object_proxy(L, std::move(object), 2, 3);
+
+    return 1;
+}
@@ -0,0 +1,53 @@
+#ifndef REALM_LUA_ACCESSORS_H
+#define REALM_LUA_ACCESSORS_H
+#include <lua.hpp>
+#include <realm/object-store/object_schema.hpp>
+#include <realm/object-store/c_api/types.hpp>
+
+#include "realm_util.hpp"
+
+// An object proxy is a single userdata holding the object in place. It
+// starts with a handle pointing to the object, so that it can be passed to
+// natives like any object handle and be tracked by its realm. The realm and
+// the class info are its 1st and 2nd user values, and the handle returned for
+// `_handle` is kept as the 3rd.
+struct ObjectProxy {
+    realm_lua_handle handle;
+    // Destroyed when the handle is released rather than with the proxy.
+    union {
+        realm_object_t value;
+    };
+
+    explicit ObjectProxy(realm::Object&& obj)
+    : handle{&value, &handle, &handle, destroy}
+    , value(std::move(obj))
+    { }
+
+    ~ObjectProxy() { }
+
+    // Get the object, or null once it has been released.
+    realm_object_t* object() {
+        return static_cast<realm_object_t*>(handle.value);
+    }
+
+    static void destroy(void* value) {
+        static_cast<realm_object_t*>(value)->~realm_object_t();
+    }
+};
+
+// Push the metatable of the objects of a class onto the Lua stack. Its
+// __index and __newindex read and write the single values of the class
+// natively, and call those of the RealmObject table at object_table for
+// everything else (references and collections).
+void _push_class_metatable(lua_State*, const realm::ObjectSchema&, int object_table);
+
+// Check whether the value at the given index is an object proxy.
+bool _is_object_proxy(lua_State*, int index);
+
+// Push a proxy of the object onto the Lua stack, with the realm table and
+// the class info at the given indices.
+void _push_object_proxy(lua_State*, realm::Object object, int realm_index, int class_info_index);
+
+int lib_realm_object_to_proxy(lua_State* L);
+
+#endif
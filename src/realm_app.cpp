@@ -34,8 +34,7 @@ static void on_log_in_complete(realm_lua_userdata* userdata, realm_user_t* user_
     // the realm user and an error message) as argument(s) to the user's callback.
     int num_callback_args = 1;
     if (user_arg) {
-        realm_user_t** user = static_cast<realm_user_t**>(lua_newuserdata(L, sizeof(realm_user_t*)));
-        luaL_setmetatable(L, RealmHandle);
+        realm_user_t** user = push_handle<realm_user_t>(L);
         *user = (realm_user_t*)realm_clone(user_arg);
     }
     else {
@@ -67,8 +66,7 @@ static int lib_realm_app_create(lua_State* L) {
     realm_sync_client_config_set_metadata_mode(sync_client_config, RLM_SYNC_CLIENT_METADATA_MODE_PLAINTEXT);
 
     // Create and push the realm app onto the stack and set its metatable.
-    realm_app_t** app = static_cast<realm_app_t**>(lua_newuserdata(L, sizeof(realm_app_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_app_t** app = push_handle<realm_app_t>(L);
     *app = realm_app_create(app_config, sync_client_config);
 
     realm_release(http_transport);
@@ -129,8 +127,7 @@ static int lib_realm_app_credentials_new_email_password(lua_State* L) {
     };
 
     // Create and push the realm app credentials onto the stack and set its metatable.
-    realm_app_credentials_t** app_credentials = static_cast<realm_app_credentials_t**>(lua_newuserdata(L, sizeof(realm_app_credentials_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_app_credentials_t** app_credentials = push_handle<realm_app_credentials_t>(L);
     *app_credentials = realm_app_credentials_new_email_password(email, password);
 
     return 1;
@@ -172,8 +169,7 @@ static int lib_realm_app_get_current_user(lua_State* L) {
     // Create and push the user (or nil) onto the stack and set its metatable.
     realm_user_t* user = realm_app_get_current_user(*app);
     if (user) {
-        realm_user_t** userData = static_cast<realm_user_t**>(lua_newuserdata(L, sizeof(realm_user_t*)));
-        luaL_setmetatable(L, RealmHandle);
+        realm_user_t** userData = push_handle<realm_user_t>(L);
         *userData = user;
     }
     else {
@@ -191,8 +187,7 @@ static int lib_realm_app_credentials_new_anonymous(lua_State* L) {
     }
 
     // Create and push the realm app credentials onto the stack and set its metatable.
-    realm_app_credentials_t** app_credentials = static_cast<realm_app_credentials_t**>(lua_newuserdata(L, sizeof(realm_app_credentials_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_app_credentials_t** app_credentials = push_handle<realm_app_credentials_t>(L);
     *app_credentials = realm_app_credentials_new_anonymous(reuse_credentials);
 
     return 1;
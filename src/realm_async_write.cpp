@@ -0,0 +1,125 @@
+#define realm_userdata_t struct realm_lua_userdata*
+
+#include <realm.h>
+#include "realm_util.hpp"
+#include "realm_async_write.hpp"
+
+// The state of an asynchronous write, from when it is requested until it is
+// committed or cancelled. It is first owned by the request to begin the write
+// and then handed over to the request to commit it.
+struct realm_lua_async_write : realm_lua_userdata {
+    realm_t* realm;
+    // A reference to the realm handle, keeping the realm open.
+    int realm_reference;
+    // A reference to the function to call once committed, or LUA_REFNIL.
+    int committed_reference;
+    bool allow_grouping;
+    bool is_committing = false;
+
+    ~realm_lua_async_write() {
+        luaL_unref(L, LUA_REGISTRYINDEX, realm_reference);
+        luaL_unref(L, LUA_REGISTRYINDEX, committed_reference);
+    }
+};
+
+static void free_async_write_unless_committing(realm_lua_userdata* userdata) {
+    if (!static_cast<realm_lua_async_write*>(userdata)->is_committing) {
+        free_lua_userdata(userdata);
+    }
+}
+
+// Call the function to call once committed, if any, with the error or nil.
+// Errors are logged rather than raised, as they would unwind through Realm.
+static void call_committed(realm_lua_async_write* write, const char* error) {
+    lua_State* L = write->L;
+    if (write->committed_reference == LUA_REFNIL) {
+        if (error) {
+            lua_pushfstring(L, "Could not commit the write transaction:\n%s", error);
+            log_lua_error(L, LUA_ERRRUN);
+        }
+        return;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, write->committed_reference);
+    if (error) {
+        lua_pushstring(L, error);
+    }
+    else {
+        lua_pushnil(L);
+    }
+    log_lua_error(L, lua_pcall(L, 1, 0, 0));
+}
+
+// The commit frees the state itself once called. If the commit request
+// fails, the C API frees its userdata while unwinding, so it must not be
+// given the state to free.
+static void free_nothing(realm_lua_userdata*) {
+}
+
+static void on_async_write_commit(realm_lua_userdata* userdata, bool error, const char* description) {
+    call_committed(static_cast<realm_lua_async_write*>(userdata), error ? description : nullptr);
+    free_lua_userdata(userdata);
+}
+
+static void on_async_write_begin(realm_lua_userdata* userdata) {
+    auto* write = static_cast<realm_lua_async_write*>(userdata);
+    lua_State* L = write->L;
+
+    // Call the write function within the write transaction, cancelling it
+    // and passing the error on if it fails.
+    lua_rawgeti(L, LUA_REGISTRYINDEX, write->callback_reference);
+    if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+        realm_rollback(write->realm);
+        call_committed(write, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return;
+    }
+
+    // Commit without waiting for the changes to be written to disk, handing
+    // the state over to the commit. If it fails, the state stays with the
+    // request to begin the write, which frees it.
+    write->is_committing = true;
+    if (!realm_async_commit(write->realm, on_async_write_commit, write, free_nothing, write->allow_grouping, nullptr)) {
+        write->is_committing = false;
+        realm_error_t error;
+        realm_get_last_error(&error);
+        call_committed(write, error.message);
+    }
+}
+
+int lib_realm_async_write(lua_State* L) {
+    // Get arguments (realm, write function, committed function and whether
+    // the commit may be grouped with others) from the stack.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    if (!lua_isnoneornil(L, 3)) {
+        luaL_checktype(L, 3, LUA_TFUNCTION);
+    }
+    bool allow_grouping = lua_toboolean(L, 4);
+    if (!*realm) {
+        return _inform_error(L, "Invalid realm");
+    }
+
+    // Create a pointer to userdata for use in the callbacks that will be
+    // invoked at a later time.
+    auto* userdata = new realm_lua_async_write;
+    userdata->L = L;
+    userdata->realm = *realm;
+    userdata->allow_grouping = allow_grouping;
+    lua_pushvalue(L, 1);
+    userdata->realm_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pushvalue(L, 2);
+    userdata->callback_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pushvalue(L, 3);
+    userdata->committed_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    // Request the write transaction, which begins once the write lock has
+    // been acquired without blocking, and push its id onto the stack.
+    unsigned int transaction_id;
+    if (!realm_async_begin_write(*realm, on_async_write_begin, userdata, free_async_write_unless_committing, false, &transaction_id)) {
+        return _inform_realm_error(L);
+    }
+    lua_pushinteger(L, transaction_id);
+
+    return 1;
+}
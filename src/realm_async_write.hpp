@@ -0,0 +1,3 @@
+#include <lua.hpp>
+
+int lib_realm_async_write(lua_State* L);
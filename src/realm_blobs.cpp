@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <realm/object-store/c_api/types.hpp>
+#include <realm/object-store/shared_realm.hpp>
+
+#include "realm_blobs.hpp"
+#include "realm_util.hpp"
+
+// Get the binary column of a property key, or throw if it is not one.
+static realm::ColKey get_blob_column(realm_property_key_t property_key) {
+    realm::ColKey column(property_key);
+    if (column.is_collection() || column.get_type() != realm::col_type_Binary) {
+        throw std::invalid_argument("Blobs can only be read and written on binary properties");
+    }
+
+    return column;
+}
+
+int lib_realm_object_read_blob(lua_State* L) {
+    // Get arguments from the stack.
+    realm_object_t* object = *check_handle<realm_object_t>(L, 1, "object");
+    realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 2)));
+    lua_Integer offset = luaL_checkinteger(L, 3);
+    lua_Integer length = luaL_checkinteger(L, 4);
+    if (offset < 0 || length < 0) {
+        return _inform_error(L, "The offset and length of a blob read cannot be negative");
+    }
+
+    // Push the bytes from the offset and the size of the whole blob onto the
+    // stack, copying only the bytes asked for into a Lua string.
+    try {
+        object->verify_attached();
+        realm::BinaryData value = object->obj().get<realm::BinaryData>(get_blob_column(property_key));
+        if (value.is_null()) {
+            lua_pushnil(L);
+            return 1;
+        }
+        size_t start = std::min<size_t>(offset, value.size());
+        size_t count = std::min<size_t>(length, value.size() - start);
+        lua_pushlstring(L, value.data() + start, count);
+        lua_pushinteger(L, value.size());
+        return 2;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+int lib_realm_object_write_blob(lua_State* L) {
+    // Get arguments from the stack.
+    realm_object_t* object = *check_handle<realm_object_t>(L, 1, "object");
+    realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 2)));
+    bool is_function = lua_isfunction(L, 3);
+    if (!is_function) {
+        luaL_checktype(L, 3, LUA_TTABLE);
+    }
+    lua_settop(L, 3);
+
+    // Accumulate the chunks (3rd argument, an array of strings or a function
+    // returning the next string until nil) in a Lua buffer, which is released
+    // by the garbage collector should a chunk raise an error.
+    luaL_Buffer buffer;
+    luaL_buffinit(L, &buffer);
+    for (lua_Integer index = 1;; index++) {
+        if (is_function) {
+            lua_pushvalue(L, 3);
+            lua_call(L, 0, 1);
+        }
+        else {
+            lua_rawgeti(L, 3, index);
+        }
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            break;
+        }
+        if (lua_type(L, -1) != LUA_TSTRING) {
+            return _inform_error(L, "Blob chunks must be strings, got %1", luaL_typename(L, -1));
+        }
+        luaL_addvalue(&buffer);
+    }
+
+    // Set the whole value at once.
+    try {
+        object->get_realm()->verify_in_write();
+        object->verify_attached();
+        realm::Obj obj = object->obj();
+        obj.set<realm::BinaryData>(get_blob_column(property_key), realm::BinaryData(luaL_buffaddr(&buffer), luaL_bufflen(&buffer)));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
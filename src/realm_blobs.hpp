@@ -0,0 +1,5 @@
+#include <lua.hpp>
+
+int lib_realm_object_read_blob(lua_State* L);
+
+int lib_realm_object_write_blob(lua_State* L);
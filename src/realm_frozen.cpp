@@ -0,0 +1,92 @@
+#include <realm.h>
+
+#include "realm_frozen.hpp"
+#include "realm_schema.hpp"
+#include "realm_util.hpp"
+
+int lib_realm_freeze(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+
+    // Push a frozen copy of the realm at its current version onto the stack.
+    realm_t** frozen = push_handle<realm_t>(L);
+    *frozen = static_cast<realm_t*>(realm_freeze(*realm));
+    if (!*frozen) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_results_resolve_in(lua_State* L) {
+    // Get arguments from the stack.
+    realm_results_t** results = static_cast<realm_results_t**>(luaL_checkudata(L, 1, RealmHandle));
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 2, RealmHandle));
+
+    // Push the results resolved in the (frozen) realm onto the stack.
+    realm_results_t** resolved = push_handle<realm_results_t>(L);
+    *resolved = realm_results_resolve_in(*results, *realm);
+    if (!*resolved) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_object_resolve_in(lua_State* L) {
+    // Get arguments from the stack.
+    realm_object_t* object = *check_handle<realm_object_t>(L, 1, "object");
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 2, RealmHandle));
+
+    // Push the object resolved in the (frozen) realm onto the stack, or nil
+    // if it has been deleted.
+    realm_object_t** resolved = push_handle<realm_object_t>(L);
+    if (!realm_object_resolve_in(object, *realm, resolved)) {
+        return _inform_realm_error(L);
+    }
+    if (!*resolved) {
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
+
+void release_exported_realm(void* value) {
+    realm_release(value);
+}
+
+int lib_realm_export_frozen(lua_State* L) {
+    // Push a token owning a new instance of the frozen realm, to be imported
+    // exactly once, possibly by another Lua state. It is released with the
+    // token if it is never imported.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+    if (!*realm || !realm_is_frozen(*realm)) {
+        return _inform_error(L, "Only frozen realms can be shared with other Lua states");
+    }
+    realm_lua_handle* token = push_handle_node(L);
+    token->value = realm_clone(*realm);
+    token->release = release_exported_realm;
+    if (!token->value) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_import_frozen(lua_State* L) {
+    // Take the realm out of a token exported by realm_export_frozen (1st
+    // argument) and push its handle and schema information onto the stack.
+    auto* token = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    if (token->release != release_exported_realm) {
+        return luaL_typeerror(L, 1, "exported frozen realm");
+    }
+    if (!token->value) {
+        return _inform_error(L, "The frozen realm has already been imported");
+    }
+    realm_t** realm = push_handle<realm_t>(L);
+    *realm = static_cast<realm_t*>(token->value);
+    token->value = nullptr;
+    _push_schema_info(L, *realm, 2);
+
+    return 3;
+}
@@ -0,0 +1,15 @@
+#include <lua.hpp>
+
+int lib_realm_freeze(lua_State* L);
+
+int lib_realm_results_resolve_in(lua_State* L);
+
+int lib_realm_object_resolve_in(lua_State* L);
+
+// Release a frozen realm exported to another Lua state. Also tells the
+// tokens holding one apart.
+void release_exported_realm(void* value);
+
+int lib_realm_export_frozen(lua_State* L);
+
+int lib_realm_import_frozen(lua_State* L);
@@ -0,0 +1,760 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "realm_import.hpp"
+#include "realm_util.hpp"
+
+namespace import {
+
+enum class Format {
+    NDJson,
+    Csv,
+};
+
+// The properties of the class the records are imported into.
+struct Schema {
+    realm_class_key_t class_key;
+    std::string class_name;
+    std::vector<realm_property_info_t> properties;
+    std::unordered_map<std::string_view, size_t> by_name;
+    // The index of the primary key property, or -1 without one.
+    ptrdiff_t primary_key = -1;
+    // The index of the property of each field of the CSV header.
+    std::vector<size_t> csv_columns;
+};
+
+// Records read from the file, to be parsed together.
+struct Chunk {
+    // The position of the chunk in the file, in which the batches are written.
+    size_t sequence = 0;
+    size_t first_record = 1;
+    std::string text;
+    // The end of each record in the text.
+    std::vector<size_t> ends;
+    // The error reading the records, in place of the rest of the file.
+    std::string error;
+};
+
+// The values of parsed records, to be written in a single transaction. The
+// values point into the text of the records or into the unescaped strings,
+// which are held so that they keep their address when the batch is moved
+// (short strings are stored inline).
+struct Batch {
+    size_t sequence = 0;
+    size_t first_record = 1;
+    size_t num_rows = 0;
+    std::unique_ptr<const std::string> text;
+    std::deque<std::string> strings;
+    // The value of every property of every row, and whether it was set.
+    std::vector<realm_value_t> values;
+    std::vector<bool> present;
+    // The error reading or parsing the records, which is raised once the
+    // batches before it have been written.
+    std::string error;
+};
+
+// A queue between the threads of the import, holding a limited number of
+// items. Closing it lets the items be taken until it is empty, cancelling it
+// drops them and stops the threads waiting on it.
+template <typename T>
+class Channel {
+public:
+    Channel(size_t capacity)
+    : m_capacity(capacity)
+    { }
+
+    // Returns false if the channel has been cancelled.
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_full.wait(lock, [&] { return m_cancelled || m_items.size() < m_capacity; });
+        if (m_cancelled) {
+            return false;
+        }
+        m_items.push_back(std::move(item));
+        m_not_empty.notify_one();
+
+        return true;
+    }
+
+    // Returns false once the channel is closed and empty, or cancelled.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [&] { return m_cancelled || m_closed || !m_items.empty(); });
+        if (m_cancelled || m_items.empty()) {
+            return false;
+        }
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_not_empty.notify_all();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_items.clear();
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::deque<T> m_items;
+    size_t m_capacity;
+    bool m_closed = false;
+    bool m_cancelled = false;
+};
+
+static std::runtime_error realm_exception() {
+    realm_error_t error;
+    realm_get_last_error(&error);
+
+    return std::runtime_error(error.message);
+}
+
+// Reads the records of a file, a line each, or more for quoted CSV fields.
+class RecordReader {
+public:
+    RecordReader(std::istream& in, Format format)
+    : m_in(in)
+    , m_format(format)
+    { }
+
+    // Append the next record to the text, skipping blank lines. Returns false
+    // at the end of the file.
+    bool next(std::string& text) {
+        bool in_quotes = false;
+        while (std::getline(m_in, m_line)) {
+            if (!m_line.empty() && m_line.back() == '\r') {
+                m_line.pop_back();
+            }
+            if (in_quotes) {
+                text += '\n';
+            }
+            else if (m_line.find_first_not_of(" \t") == std::string::npos) {
+                continue;
+            }
+            text += m_line;
+            if (m_format == Format::Csv && std::count(m_line.begin(), m_line.end(), '"') % 2 == 1) {
+                in_quotes = !in_quotes;
+            }
+            if (!in_quotes) {
+                return true;
+            }
+        }
+        if (in_quotes) {
+            throw std::runtime_error("The file ends within a quoted field");
+        }
+
+        return false;
+    }
+
+    // Read the rest of the file in chunks of records. An error replaces the
+    // chunk it occurs in, so that the chunks before it are still written.
+    void read_chunks(size_t batch_size, Channel<Chunk>& chunks) {
+        Chunk chunk = next_chunk();
+        try {
+            while (next(chunk.text)) {
+                chunk.ends.push_back(chunk.text.size());
+                m_records++;
+                if (chunk.ends.size() == batch_size) {
+                    if (!chunks.push(std::move(chunk))) {
+                        return;
+                    }
+                    chunk = next_chunk();
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            chunk.error = e.what();
+        }
+        if (!chunk.ends.empty() || !chunk.error.empty()) {
+            chunks.push(std::move(chunk));
+        }
+    }
+
+private:
+    Chunk next_chunk() {
+        Chunk chunk;
+        chunk.sequence = m_chunks++;
+        chunk.first_record = m_records + 1;
+
+        return chunk;
+    }
+
+    std::istream& m_in;
+    Format m_format;
+    std::string m_line;
+    size_t m_records = 0;
+    size_t m_chunks = 0;
+};
+
+// A value as written in a record.
+struct Token {
+    enum Kind {
+        Null,
+        Boolean,
+        Number,
+        String,
+        // An unquoted CSV field, of any type.
+        Text,
+    };
+    Kind kind;
+    std::string_view text;
+};
+
+// Parse the whole text as a number.
+template <typename T>
+static bool parse_number(std::string_view text, T& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+// Convert a token into a value of the type of its property.
+static realm_value_t to_value(const realm_property_info_t& property, const Token& token) {
+    bool is_string = property.type == RLM_PROPERTY_TYPE_STRING || property.type == RLM_PROPERTY_TYPE_BINARY;
+    bool nullable = property.flags & RLM_PROPERTY_NULLABLE;
+    // Empty fields are null, unless the property is a string which cannot be.
+    if (token.kind == Token::Null || (token.kind == Token::Text && token.text.empty() && (nullable || !is_string))) {
+        if (!nullable) {
+            throw std::runtime_error(realm::util::format("Property '%1' cannot be null", property.name));
+        }
+        return realm_value_t { .type = RLM_TYPE_NULL };
+    }
+
+    const char* begin = token.text.data();
+    bool is_number = token.kind == Token::Number || token.kind == Token::Text;
+    switch (property.type) {
+        case RLM_PROPERTY_TYPE_INT: {
+            int64_t integer;
+            if (is_number && parse_number(token.text, integer)) {
+                return realm_value_t { .type = RLM_TYPE_INT, .integer = integer };
+            }
+            break;
+        }
+        case RLM_PROPERTY_TYPE_FLOAT:
+        case RLM_PROPERTY_TYPE_DOUBLE: {
+            double number;
+            if (is_number && parse_number(token.text, number)) {
+                if (property.type == RLM_PROPERTY_TYPE_FLOAT) {
+                    return realm_value_t { .type = RLM_TYPE_FLOAT, .fnum = static_cast<float>(number) };
+                }
+                return realm_value_t { .type = RLM_TYPE_DOUBLE, .dnum = number };
+            }
+            break;
+        }
+        case RLM_PROPERTY_TYPE_BOOL:
+            if (token.kind == Token::Boolean || token.kind == Token::Text) {
+                if (token.text == "true" || token.text == "false") {
+                    return realm_value_t { .type = RLM_TYPE_BOOL, .boolean = token.text == "true" };
+                }
+            }
+            break;
+        case RLM_PROPERTY_TYPE_STRING:
+            if (token.kind == Token::String || token.kind == Token::Text) {
+                return realm_value_t { .type = RLM_TYPE_STRING, .string = { begin, token.text.size() } };
+            }
+            break;
+        case RLM_PROPERTY_TYPE_BINARY:
+            if (token.kind == Token::String || token.kind == Token::Text) {
+                return realm_value_t {
+                    .type = RLM_TYPE_BINARY,
+                    .binary = { reinterpret_cast<const uint8_t*>(begin), token.text.size() },
+                };
+            }
+            break;
+        default:
+            throw std::runtime_error(realm::util::format("Property '%1' cannot be imported", property.name));
+    }
+
+    throw std::runtime_error(realm::util::format("Invalid value '%1' for property '%2'", std::string(token.text), property.name));
+}
+
+static void set_value(const Schema& schema, size_t property_index, const Token& token, Batch& batch, size_t row) {
+    const realm_property_info_t& property = schema.properties[property_index];
+    if (property.collection_type != RLM_COLLECTION_TYPE_NONE) {
+        throw std::runtime_error(realm::util::format("Property '%1' cannot be imported", property.name));
+    }
+    size_t index = row * schema.properties.size() + property_index;
+    batch.values[index] = to_value(property, token);
+    batch.present[index] = true;
+}
+
+// Parses the flat JSON object of a record.
+class JsonParser {
+public:
+    JsonParser(std::string_view text, Batch& batch)
+    : m_text(text)
+    , m_batch(batch)
+    { }
+
+    template <typename Fn>
+    void parse_object(Fn&& on_member) {
+        expect('{');
+        if (peek() == '}') {
+            m_pos++;
+        }
+        else {
+            do {
+                if (peek() != '"') {
+                    fail("Expected a property name");
+                }
+                std::string_view key = parse_string();
+                expect(':');
+                on_member(key, parse_value());
+            } while (accept(','));
+            expect('}');
+        }
+        if (peek() != '\0') {
+            fail("Unexpected characters after the object");
+        }
+    }
+
+private:
+    [[noreturn]] void fail(const char* message) {
+        throw std::runtime_error(realm::util::format("%1 at column %2", message, m_pos + 1));
+    }
+
+    // Get the next character which is not whitespace, or '\0' at the end.
+    char peek() {
+        while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t')) {
+            m_pos++;
+        }
+
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    bool accept(char c) {
+        if (peek() == c) {
+            m_pos++;
+            return true;
+        }
+
+        return false;
+    }
+
+    void expect(char c) {
+        if (!accept(c)) {
+            fail(realm::util::format("Expected '%1'", std::string(1, c)).c_str());
+        }
+    }
+
+    Token parse_value() {
+        char c = peek();
+        if (c == '"') {
+            return Token { Token::String, parse_string() };
+        }
+        if (c == '{' || c == '[') {
+            fail("Nested objects and arrays cannot be imported");
+        }
+        size_t begin = m_pos;
+        while (m_pos < m_text.size() && std::string_view(",} \t").find(m_text[m_pos]) == std::string_view::npos) {
+            m_pos++;
+        }
+        std::string_view literal = m_text.substr(begin, m_pos - begin);
+        if (literal == "null") {
+            return Token { Token::Null, literal };
+        }
+        if (literal == "true" || literal == "false") {
+            return Token { Token::Boolean, literal };
+        }
+        if (literal.empty()) {
+            fail("Expected a value");
+        }
+        // JSON numbers may start with a '-' but not a '+', which from_chars agrees with.
+        return Token { Token::Number, literal };
+    }
+
+    // Parse a string, which is only copied if it has escape sequences.
+    std::string_view parse_string() {
+        expect('"');
+        size_t begin = m_pos;
+        size_t end = m_text.find_first_of("\"\\", begin);
+        if (end != std::string_view::npos && m_text[end] == '"') {
+            m_pos = end + 1;
+            return m_text.substr(begin, end - begin);
+        }
+
+        std::string& string = m_batch.strings.emplace_back(m_text.substr(begin, end - begin));
+        m_pos = std::min(end, m_text.size());
+        while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+            char c = m_text[m_pos++];
+            if (c != '\\') {
+                string += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) {
+                break;
+            }
+            switch (char escape = m_text[m_pos++]) {
+                case 'b': string += '\b'; break;
+                case 'f': string += '\f'; break;
+                case 'n': string += '\n'; break;
+                case 'r': string += '\r'; break;
+                case 't': string += '\t'; break;
+                case 'u': append_utf8(string, parse_code_point()); break;
+                default: string += escape; break;
+            }
+        }
+        expect('"');
+
+        return string;
+    }
+
+    uint32_t parse_hex() {
+        uint32_t value = 0;
+        if (m_pos + 4 > m_text.size() || std::from_chars(m_text.data() + m_pos, m_text.data() + m_pos + 4, value, 16).ptr != m_text.data() + m_pos + 4) {
+            fail("Invalid unicode escape");
+        }
+        m_pos += 4;
+
+        return value;
+    }
+
+    uint32_t parse_code_point() {
+        uint32_t code_point = parse_hex();
+        // Combine the surrogate pairs of characters outside the basic plane.
+        if (code_point >= 0xD800 && code_point < 0xDC00 && m_text.substr(m_pos, 2) == "\\u") {
+            m_pos += 2;
+            uint32_t low = parse_hex();
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        return code_point;
+    }
+
+    static void append_utf8(std::string& string, uint32_t code_point) {
+        if (code_point < 0x80) {
+            string += static_cast<char>(code_point);
+        }
+        else if (code_point < 0x800) {
+            string += static_cast<char>(0xC0 | (code_point >> 6));
+            string += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+        else if (code_point < 0x10000) {
+            string += static_cast<char>(0xE0 | (code_point >> 12));
+            string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+        else {
+            string += static_cast<char>(0xF0 | (code_point >> 18));
+            string += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    std::string_view m_text;
+    Batch& m_batch;
+    size_t m_pos = 0;
+};
+
+// Split a CSV record into its fields, unquoting them into the strings if needed.
+template <typename Fn>
+static void split_csv(std::string_view record, std::deque<std::string>& strings, Fn&& on_field) {
+    size_t pos = 0;
+    for (size_t field = 0;; field++) {
+        if (pos < record.size() && record[pos] == '"') {
+            size_t begin = ++pos;
+            size_t end = record.find('"', begin);
+            std::string_view text = record.substr(begin, end - begin);
+            // Quotes within quoted fields are doubled.
+            if (end != std::string_view::npos && end + 1 < record.size() && record[end + 1] == '"') {
+                std::string& string = strings.emplace_back();
+                while (end != std::string_view::npos && end + 1 < record.size() && record[end + 1] == '"') {
+                    string.append(record.substr(pos, end + 1 - pos));
+                    pos = end + 2;
+                    end = record.find('"', pos);
+                }
+                string.append(record.substr(pos, end - pos));
+                text = string;
+            }
+            if (end == std::string_view::npos) {
+                throw std::runtime_error("Unterminated quoted field");
+            }
+            pos = end + 1;
+            on_field(field, Token { Token::String, text });
+        }
+        else {
+            size_t end = std::min(record.find(',', pos), record.size());
+            on_field(field, Token { Token::Text, record.substr(pos, end - pos) });
+            pos = end;
+        }
+
+        if (pos >= record.size()) {
+            return;
+        }
+        if (record[pos] != ',') {
+            throw std::runtime_error(realm::util::format("Expected ',' at column %1", pos + 1));
+        }
+        pos++;
+    }
+}
+
+static void parse_json_record(const Schema& schema, std::string_view record, Batch& batch, size_t row) {
+    JsonParser(record, batch).parse_object([&](std::string_view key, const Token& token) {
+        auto it = schema.by_name.find(key);
+        if (it == schema.by_name.end()) {
+            throw std::runtime_error(realm::util::format("Property '%1' not found on type %2", std::string(key), schema.class_name));
+        }
+        set_value(schema, it->second, token, batch, row);
+    });
+}
+
+static void parse_csv_record(const Schema& schema, std::string_view record, Batch& batch, size_t row) {
+    split_csv(record, batch.strings, [&](size_t field, const Token& token) {
+        if (field >= schema.csv_columns.size()) {
+            throw std::runtime_error("The record has more fields than the header");
+        }
+        set_value(schema, schema.csv_columns[field], token, batch, row);
+    });
+}
+
+static Batch parse_chunk(const Schema& schema, Format format, Chunk&& chunk) {
+    Batch batch;
+    batch.sequence = chunk.sequence;
+    batch.first_record = chunk.first_record;
+    if (!chunk.error.empty()) {
+        batch.error = std::move(chunk.error);
+        return batch;
+    }
+    batch.num_rows = chunk.ends.size();
+    // Move the text first, as the values point into it.
+    batch.text = std::make_unique<const std::string>(std::move(chunk.text));
+    batch.values.resize(batch.num_rows * schema.properties.size());
+    batch.present.resize(batch.values.size());
+
+    size_t begin = 0;
+    for (size_t row = 0; row < batch.num_rows; row++) {
+        std::string_view record(batch.text->data() + begin, chunk.ends[row] - begin);
+        begin = chunk.ends[row];
+        try {
+            if (format == Format::NDJson) {
+                parse_json_record(schema, record, batch, row);
+            }
+            else {
+                parse_csv_record(schema, record, batch, row);
+            }
+        }
+        catch (const std::exception& e) {
+            batch.error = realm::util::format("Could not import record %1: %2", batch.first_record + row, e.what());
+            break;
+        }
+    }
+
+    return batch;
+}
+
+// Create the objects of a batch in a single write transaction.
+static void write_batch(realm_t* realm, const Schema& schema, const Batch& batch) {
+    if (!realm_begin_write(realm)) {
+        throw realm_exception();
+    }
+    size_t num_properties = schema.properties.size();
+    std::vector<realm_property_key_t> keys;
+    std::vector<realm_value_t> values;
+    for (size_t row = 0; row < batch.num_rows; row++) {
+        const realm_value_t* row_values = &batch.values[row * num_properties];
+        size_t first = row * num_properties;
+
+        realm_object_t* object = nullptr;
+        if (schema.primary_key < 0) {
+            object = realm_object_create(realm, schema.class_key);
+        }
+        else if (batch.present[first + schema.primary_key]) {
+            object = realm_object_create_with_primary_key(realm, schema.class_key, row_values[schema.primary_key]);
+        }
+        else {
+            realm_rollback(realm);
+            throw std::runtime_error(realm::util::format("Could not import record %1: Primary key not set", batch.first_record + row));
+        }
+
+        keys.clear();
+        values.clear();
+        for (size_t i = 0; i < num_properties; i++) {
+            if (batch.present[first + i] && static_cast<ptrdiff_t>(i) != schema.primary_key) {
+                keys.push_back(schema.properties[i].key);
+                values.push_back(row_values[i]);
+            }
+        }
+        if (!object || !realm_set_values(object, keys.size(), keys.data(), values.data(), false)) {
+            std::runtime_error error = realm_exception();
+            realm_release(object);
+            realm_rollback(realm);
+            throw std::runtime_error(realm::util::format("Could not import record %1: %2", batch.first_record + row, error.what()));
+        }
+        realm_release(object);
+    }
+    if (!realm_commit(realm)) {
+        std::runtime_error error = realm_exception();
+        realm_rollback(realm);
+        throw error;
+    }
+}
+
+// Import the records of a file as objects, reading them on one thread and
+// parsing them on others, while this thread, which owns the realm, writes
+// them in batches in the order of the file, so that an error keeps exactly
+// the batches before it. Returns the number of objects created.
+static size_t import_file(realm_t* realm, Schema& schema, std::istream& file, Format format, size_t batch_size, size_t num_threads) {
+    RecordReader reader(file, format);
+    if (format == Format::Csv) {
+        std::string header;
+        std::deque<std::string> strings;
+        if (!reader.next(header)) {
+            return 0;
+        }
+        split_csv(header, strings, [&](size_t, const Token& token) {
+            auto it = schema.by_name.find(token.text);
+            if (it == schema.by_name.end()) {
+                throw std::runtime_error(realm::util::format("Property '%1' not found on type %2", std::string(token.text), schema.class_name));
+            }
+            schema.csv_columns.push_back(it->second);
+        });
+    }
+
+    Channel<Chunk> chunks(num_threads * 2);
+    Channel<Batch> batches(num_threads * 2);
+    std::mutex failure_mutex;
+    std::string failure;
+    auto fail = [&](const char* message) {
+        {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+            if (failure.empty()) {
+                failure = message;
+            }
+        }
+        chunks.cancel();
+        batches.cancel();
+    };
+
+    std::atomic<size_t> parsers{num_threads};
+    std::vector<std::thread> threads;
+    size_t count = 0;
+    try {
+        threads.emplace_back([&] {
+            try {
+                reader.read_chunks(batch_size, chunks);
+            }
+            catch (const std::exception& e) {
+                fail(e.what());
+            }
+            chunks.close();
+        });
+        for (size_t i = 0; i < num_threads; i++) {
+            threads.emplace_back([&] {
+                try {
+                    Chunk chunk;
+                    while (chunks.pop(chunk) && batches.push(parse_chunk(schema, format, std::move(chunk)))) {
+                    }
+                }
+                catch (const std::exception& e) {
+                    fail(e.what());
+                }
+                // The last parser lets the writer know that no batch is left.
+                if (--parsers == 0) {
+                    batches.close();
+                }
+            });
+        }
+
+        // Hold the batches parsed ahead of the next one to write.
+        std::map<size_t, Batch> parsed;
+        size_t next_sequence = 0;
+        Batch batch;
+        while (batches.pop(batch)) {
+            size_t sequence = batch.sequence;
+            parsed.emplace(sequence, std::move(batch));
+            for (auto it = parsed.begin(); it != parsed.end() && it->first == next_sequence; it = parsed.erase(it)) {
+                if (!it->second.error.empty()) {
+                    throw std::runtime_error(it->second.error);
+                }
+                write_batch(realm, schema, it->second);
+                count += it->second.num_rows;
+                next_sequence++;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        fail(e.what());
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!failure.empty()) {
+        throw std::runtime_error(failure);
+    }
+
+    return count;
+}
+
+}
+
+int lib_realm_import(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+    const char* path = luaL_checkstring(L, 2);
+    realm_class_key_t class_key = luaL_checkinteger(L, 3);
+    const char* formats[] = {"ndjson", "csv", NULL};
+    auto format = static_cast<import::Format>(luaL_checkoption(L, 4, "ndjson", formats));
+    lua_Integer batch_size = luaL_optinteger(L, 5, 10000);
+    // The thread calling writes, and another one reads the file.
+    lua_Integer num_threads = luaL_optinteger(L, 6, std::max(std::thread::hardware_concurrency(), 3u) - 2);
+    if (batch_size < 1 || num_threads < 1) {
+        return _inform_error(L, "The batch size and number of threads must be positive");
+    }
+
+    try {
+        import::Schema schema;
+        schema.class_key = class_key;
+        realm_class_info_t class_info;
+        if (!realm_get_class(*realm, class_key, &class_info) || !get_class_properties(*realm, class_key, schema.properties)) {
+            throw import::realm_exception();
+        }
+        schema.class_name = class_info.name;
+        for (size_t i = 0; i < schema.properties.size(); i++) {
+            const realm_property_info_t& property = schema.properties[i];
+            schema.by_name.emplace(property.name, i);
+            if (property.flags & RLM_PROPERTY_PRIMARY_KEY) {
+                schema.primary_key = i;
+            }
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error(realm::util::format("Could not open '%1'", path));
+        }
+        size_t count = import::import_file(*realm, schema, file, format, batch_size, num_threads);
+        lua_pushinteger(L, count);
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
@@ -0,0 +1,3 @@
+#include <lua.hpp>
+
+int lib_realm_import(lua_State* L);
@@ -1,14 +1,27 @@
+#include <cstring>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
 
+#include <realm/disable_sync_to_disk.hpp>
 #include <realm/util/to_string.hpp>
+#include <realm/object-store/c_api/types.hpp>
 
 // NOTE: Make sure to include realm_notifications before realm.h.
 #include "realm_notifications.hpp"
 #include <realm.h>
+#include "realm_accessors.hpp"
+#include "realm_async_write.hpp"
+#include "realm_blobs.hpp"
+#include "realm_frozen.hpp"
+#include "realm_import.hpp"
 #include "realm_native_lib.hpp"
+#include "realm_query.hpp"
 #include "realm_schema.hpp"
 #include "realm_util.hpp"
+#include "realm_views.hpp"
+#include "realm_workers.hpp"
 
 static int lib_realm_open(lua_State* L) {
     luaL_checktype(L, 1, LUA_TTABLE);
@@ -79,6 +92,32 @@ static int lib_realm_open(lua_State* L) {
     }
     lua_pop(L, 1);
     
+    lua_getfield(L, 1, "inMemory");
+    if (lua_toboolean(L, -1)) {
+        realm_config_set_in_memory(config, true);
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "durability");
+    if (!lua_isnil(L, -1)) {
+        std::string_view durability = lua_isstring(L, -1) ? lua_tostringview(L, -1) : std::string_view();
+        if (durability == "memOnly") {
+            realm_config_set_in_memory(config, true);
+        }
+        else if (durability == "full" && realm::get_disable_sync_to_disk()) {
+            // Syncing to disk can only be disabled for the whole process.
+            realm_release(config);
+            realm_release(sync_config);
+            return _inform_error(L, "Full durability was requested, but syncing to disk has been disabled for the process.");
+        }
+        else if (durability != "full") {
+            realm_release(config);
+            realm_release(sync_config);
+            return _inform_error(L, "durability must be \"full\" or \"memOnly\", got %1.", luaL_tolstring(L, -1, nullptr));
+        }
+    }
+    lua_pop(L, 1);
+
     lua_getfield(L, 1, "_cached");
     if (lua_isboolean(L, -1)) {
         realm_config_set_cached(config, lua_toboolean(L, -1));
@@ -97,8 +136,7 @@ static int lib_realm_open(lua_State* L) {
         realm_config_set_scheduler(config, *scheduler);
     }
 
-    const realm_t** realm = static_cast<const realm_t**>(lua_newuserdata(L, sizeof(realm_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    const realm_t** realm = push_handle<const realm_t>(L);
     *realm = realm_open(config);
     realm_release(config);
     realm_release(sync_config);
@@ -106,16 +144,68 @@ static int lib_realm_open(lua_State* L) {
         // Exception ocurred while trying to open realm.
         return _inform_realm_error(L);
     }
-    _push_schema_info(L, *realm);
+    _push_schema_info(L, *realm, 3);
 
-    return 2;
+    return 3;
+}
+
+static int lib_realm_disable_sync_to_disk(lua_State* L) {
+    // Core only offers this for the whole process, and it cannot be undone.
+    realm::disable_sync_to_disk();
+
+    return 0;
 }
 
 static int lib_realm_release(lua_State* L) {
+    auto* handle = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    release_handle(handle);
+
+    return 0;
+}
+
+static int lib_realm_track_handle(lua_State* L) {
+    // Link the handle (2nd argument) into the ring of the realm (1st argument).
+    auto* realm = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    auto* handle = static_cast<realm_lua_handle*>(luaL_checkudata(L, 2, RealmHandle));
+    link_handle(realm, handle);
+
+    return 0;
+}
+
+static int lib_realm_release_handles(lua_State* L) {
+    auto* realm = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    release_handles(realm, realm);
+
+    return 0;
+}
+
+static int lib_realm_scope_begin(lua_State* L) {
+    // Push a marker linked into the ring of the realm (1st argument). Handles
+    // tracked afterwards are linked between the realm and the marker.
+    auto* realm = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    realm_lua_handle* marker = push_handle_node(L);
+    link_handle(realm, marker);
+
+    return 1;
+}
+
+static int lib_realm_scope_end(lua_State* L) {
+    // Release the handles tracked since the marker (2nd argument) was pushed.
+    auto* realm = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+    auto* marker = static_cast<realm_lua_handle*>(luaL_checkudata(L, 2, RealmHandle));
+    release_handles(realm, marker);
+    release_handle(marker);
+
+    return 0;
+}
+
+static int lib_realm_close(lua_State* L) {
     luaL_checkudata(L, 1, RealmHandle);
-    void** realm_handle = static_cast<void**>(lua_touserdata(L, -1));
-    realm_release(*realm_handle);
-    *realm_handle = nullptr;
+    realm_t** realm = (realm_t**)lua_touserdata(L, -1);
+    if (*realm && !realm_close(*realm)) {
+        // Exception ocurred while trying to close the realm.
+        return _inform_realm_error(L);
+    }
 
     return 0;
 }
@@ -156,14 +246,26 @@ static int lib_realm_cancel_transaction(lua_State* L) {
     return 0;
 }
 
+static int lib_realm_refresh(lua_State* L) {
+    luaL_checkudata(L, 1, RealmHandle);
+    realm_t** realm = (realm_t**)lua_touserdata(L, -1);
+    bool did_refresh = false;
+    if (!realm_refresh(*realm, &did_refresh)) {
+        // Exception ocurred while trying to advance to the latest version.
+        return _inform_realm_error(L);
+    }
+    lua_pushboolean(L, did_refresh);
+
+    return 1;
+}
+
 static int lib_realm_object_create(lua_State* L) {
     // Get arguments from the stack.
-    realm_t** realm = (realm_t**)lua_touserdata(L, 1);
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
     const int64_t class_key = lua_tointeger(L, 2);
 
     // Create and push a RealmObject onto the stack and set its metatable.
-    realm_object_t** realm_object = static_cast<realm_object_t**>(lua_newuserdata(L, sizeof(realm_object_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_object_t** realm_object = push_handle<realm_object_t>(L);
     *realm_object = realm_object_create(*realm, class_key); 
     if (!*realm_object) {
         // Exception ocurred when creating an object.
@@ -175,7 +277,7 @@ static int lib_realm_object_create(lua_State* L) {
 
 static int lib_realm_object_create_with_primary_key(lua_State* L) {
     // Get arguments from the stack.
-    realm_t** realm = (realm_t**)lua_touserdata(L, 1);
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
     const int class_key = lua_tointeger(L, 2);
     std::optional<realm_value_t> pk = lua_to_realm_value(L, 3);
     if (!pk) {
@@ -184,8 +286,7 @@ static int lib_realm_object_create_with_primary_key(lua_State* L) {
     }
 
     // Create and push a RealmObject onto the stack and set its metatable.
-    realm_object_t** realm_object = static_cast<realm_object_t**>(lua_newuserdata(L, sizeof(realm_object_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_object_t** realm_object = push_handle<realm_object_t>(L);
     *realm_object = realm_object_create_with_primary_key(*realm, class_key, *pk); 
     if (!*realm_object) {
         // Exception ocurred when creating an object.
@@ -195,10 +296,197 @@ static int lib_realm_object_create_with_primary_key(lua_State* L) {
     return 1;
 }
 
+// Convert a Lua value into a Realm value, raising if it has no counterpart.
+static realm_value_t check_realm_value(lua_State* L, int value_index) {
+    std::optional<realm_value_t> value = lua_to_realm_value(L, value_index);
+    if (!value) {
+        _inform_error(L, "Uknown Lua type: %1", luaL_typename(L, value_index));
+    }
+
+    return *value;
+}
+
+// Convert a value of a row passed to createMany, where references
+// are Realm objects (tables holding their handle).
+static realm_value_t row_value_to_realm_value(lua_State* L, int value_index) {
+    if (lua_istable(L, value_index)) {
+        if (lua_getfield(L, value_index, "_handle") != LUA_TUSERDATA) {
+            _inform_error(L, "Only existing Realm objects can be referenced when creating many objects");
+        }
+        realm_value_t value = check_realm_value(L, -1);
+        lua_pop(L, 1);
+        return value;
+    }
+
+    return check_realm_value(L, value_index);
+}
+
+// Release a collection held by a handle on top of the stack and pop it.
+static void pop_collection_handle(lua_State* L) {
+    release_handle(static_cast<realm_lua_handle*>(lua_touserdata(L, -1)));
+    lua_pop(L, 1);
+}
+
+// Set the value of a property (including collections) from a row passed to createMany.
+static bool set_row_value(lua_State* L, realm_object_t* object, const realm_property_info_t& property, int value_index) {
+    if (property.collection_type == RLM_COLLECTION_TYPE_NONE) {
+        return realm_set_value(object, property.key, row_value_to_realm_value(L, value_index), false);
+    }
+
+    // Collections are held by a handle while they are filled, so that they
+    // are released by the collector if a value raises an error.
+    luaL_checktype(L, value_index, LUA_TTABLE);
+    bool success = true;
+    switch (property.collection_type) {
+        case RLM_COLLECTION_TYPE_LIST: {
+            realm_list_t** list = push_handle<realm_list_t>(L);
+            *list = realm_get_list(object, property.key);
+            if (!*list) {
+                lua_pop(L, 1);
+                return false;
+            }
+            size_t num_values = lua_rawlen(L, value_index);
+            for (size_t index = 1; success && index <= num_values; index++) {
+                lua_rawgeti(L, value_index, index);
+                success = realm_list_insert(*list, index - 1, row_value_to_realm_value(L, -1));
+                lua_pop(L, 1);
+            }
+            pop_collection_handle(L);
+            break;
+        }
+        case RLM_COLLECTION_TYPE_SET: {
+            // Sets are given as arrays of their entries.
+            realm_set_t** set = push_handle<realm_set_t>(L);
+            *set = realm_get_set(object, property.key);
+            if (!*set) {
+                lua_pop(L, 1);
+                return false;
+            }
+            size_t num_values = lua_rawlen(L, value_index);
+            for (size_t index = 1; success && index <= num_values; index++) {
+                lua_rawgeti(L, value_index, index);
+                success = realm_set_insert(*set, row_value_to_realm_value(L, -1), nullptr, nullptr);
+                lua_pop(L, 1);
+            }
+            pop_collection_handle(L);
+            break;
+        }
+        case RLM_COLLECTION_TYPE_DICTIONARY: {
+            realm_dictionary_t** dictionary = push_handle<realm_dictionary_t>(L);
+            *dictionary = realm_get_dictionary(object, property.key);
+            if (!*dictionary) {
+                lua_pop(L, 1);
+                return false;
+            }
+            lua_pushnil(L);
+            while (success && lua_next(L, value_index) != 0) {
+                realm_value_t key = check_realm_value(L, -2);
+                success = realm_dictionary_insert(*dictionary, key, row_value_to_realm_value(L, -1), nullptr, nullptr);
+                lua_pop(L, 1);
+            }
+            if (!success) {
+                // Pop the key left by the interrupted traversal.
+                lua_pop(L, 1);
+            }
+            pop_collection_handle(L);
+            break;
+        }
+        default:
+            break;
+    }
+
+    return success;
+}
+
+static int lib_realm_object_create_many(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 2);
+    luaL_checktype(L, 3, LUA_TTABLE);
+    bool return_handles = lua_toboolean(L, 4);
+
+    // Resolve the class and its properties once for the whole batch.
+    realm_class_info_t class_info;
+    if (!realm_get_class(*realm, class_key, &class_info)) {
+        return _inform_realm_error(L);
+    }
+    std::vector<realm_property_info_t> class_properties;
+    if (!get_class_properties(*realm, class_key, class_properties)) {
+        return _inform_realm_error(L);
+    }
+    std::unordered_map<std::string_view, const realm_property_info_t*> properties;
+    for (const realm_property_info_t& property : class_properties) {
+        properties.emplace(property.name, &property);
+    }
+    bool has_primary_key = class_info.primary_key && *class_info.primary_key;
+
+    // Push a table for the created objects onto the stack if requested.
+    size_t num_rows = lua_rawlen(L, 3);
+    int handles_index = 0;
+    if (return_handles) {
+        lua_createtable(L, num_rows, 0);
+        handles_index = lua_gettop(L);
+    }
+
+    for (size_t row = 1; row <= num_rows; row++) {
+        lua_rawgeti(L, 3, row);
+        int row_index = lua_gettop(L);
+        luaL_checktype(L, row_index, LUA_TTABLE);
+
+        // Create the object, held by a handle so that it is released by the
+        // collector if a value of the row raises an error.
+        realm_object_t** object = push_handle<realm_object_t>(L);
+        if (has_primary_key) {
+            if (lua_getfield(L, row_index, class_info.primary_key) == LUA_TNIL) {
+                return _inform_error(L, "Primary key not set at declaration");
+            }
+            *object = realm_object_create_with_primary_key(*realm, class_key, check_realm_value(L, -1));
+            lua_pop(L, 1);
+        }
+        else {
+            *object = realm_object_create(*realm, class_key);
+        }
+        if (!*object) {
+            // Exception ocurred when creating an object.
+            return _inform_realm_error(L);
+        }
+
+        // Set the rest of the values of the row.
+        lua_pushnil(L);
+        while (lua_next(L, row_index) != 0) {
+            if (lua_type(L, -2) != LUA_TSTRING) {
+                return _inform_error(L, "Property names must be strings, got %1", luaL_typename(L, -2));
+            }
+            auto it = properties.find(lua_tostringview(L, -2));
+            if (it == properties.end()) {
+                return _inform_error(L, "Property '%1' not found on type %2", lua_tostring(L, -2), class_info.name);
+            }
+            const realm_property_info_t& property = *it->second;
+            if (!(property.flags & RLM_PROPERTY_PRIMARY_KEY) && !set_row_value(L, *object, property, lua_gettop(L))) {
+                return _inform_realm_error(L);
+            }
+            lua_pop(L, 1);
+        }
+
+        if (return_handles) {
+            // Add the handle of the object to the table.
+            lua_rawseti(L, handles_index, row);
+        }
+        else {
+            release_handle(reinterpret_cast<realm_lua_handle*>(object));
+            lua_pop(L, 1);
+        }
+        // Pop the row.
+        lua_pop(L, 1);
+    }
+
+    return return_handles ? 1 : 0;
+}
+
 static int lib_realm_set_value(lua_State* L) {
     // Get arguments from the stack.
-    realm_t** realm = (realm_t**)lua_touserdata(L, 1);
-    realm_object_t** realm_object = (realm_object_t**)lua_touserdata(L, 2);
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    realm_object_t** realm_object = check_handle<realm_object_t>(L, 2, "object");
     realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 3)));
 
     // Get the 4th argument and convert its Lua value to its corresponding Realm value.
@@ -218,8 +506,8 @@ static int lib_realm_set_value(lua_State* L) {
 
 static int lib_realm_get_value(lua_State* L) {
     // Get arguments from the stack.
-    realm_t** realm = (realm_t**)lua_touserdata(L, 1);
-    realm_object_t** realm_object = (realm_object_t**)lua_touserdata(L, 2);
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    realm_object_t** realm_object = check_handle<realm_object_t>(L, 2, "object");
     realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 3)));
 
     realm_value_t out_value;
@@ -232,8 +520,72 @@ static int lib_realm_get_value(lua_State* L) {
     return realm_to_lua_value(L, *realm, out_value);
 }
 
+static int lib_realm_get_values(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    realm_object_t** realm_object = check_handle<realm_object_t>(L, 2, "object");
+    luaL_checktype(L, 3, LUA_TTABLE);
+
+    // Read only the properties named in the optional 4th argument, otherwise all
+    // single values, using the keys cached on the class information.
+    std::vector<realm_property_key_t> property_keys;
+    int names_index;
+    if (lua_istable(L, 4)) {
+        size_t num_names = lua_rawlen(L, 4);
+        property_keys.reserve(num_names);
+        lua_createtable(L, num_names, 0);
+        names_index = lua_gettop(L);
+        lua_getfield(L, 3, "properties");
+        for (size_t index = 1; index <= num_names; index++) {
+            lua_rawgeti(L, 4, index);
+            if (lua_type(L, -1) != LUA_TSTRING || lua_rawget(L, -2) != LUA_TTABLE) {
+                lua_rawgeti(L, 4, index);
+                return _inform_error(L, "Property '%1' not found", luaL_tolstring(L, -1, nullptr));
+            }
+            // Collections are not single values, they get wrapped on the Lua side instead.
+            bool is_collection = lua_getfield(L, -1, "collectionType") != LUA_TNIL;
+            lua_pop(L, 1);
+            if (!is_collection) {
+                lua_getfield(L, -1, "key");
+                property_keys.push_back(*static_cast<realm_property_key_t*>(lua_touserdata(L, -1)));
+                lua_rawgeti(L, 4, index);
+                lua_rawseti(L, names_index, property_keys.size());
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+    }
+    else {
+        lua_getfield(L, 3, "valueNames");
+        names_index = lua_gettop(L);
+        lua_getfield(L, 3, "valueKeys");
+        auto* keys = static_cast<realm_property_key_t*>(lua_touserdata(L, -1));
+        property_keys.assign(keys, keys + lua_rawlen(L, -1) / sizeof(realm_property_key_t));
+        lua_pop(L, 1);
+    }
+
+    // Read all values at once.
+    std::vector<realm_value_t> values(property_keys.size());
+    if (!realm_get_values(*realm_object, property_keys.size(), property_keys.data(), values.data())) {
+        return _inform_realm_error(L);
+    }
+
+    // Push a table of [property_name] => value onto the stack.
+    lua_createtable(L, 0, property_keys.size());
+    for (size_t index = 0; index < values.size(); index++) {
+        lua_rawgeti(L, names_index, index + 1);
+        // Links push the object and its class key, only keep the object.
+        int num_pushed = realm_to_lua_value(L, *realm, values[index]);
+        lua_pop(L, num_pushed - 1);
+        lua_rawset(L, -3);
+    }
+
+    return 1;
+}
+
 static int lib_realm_object_delete(lua_State* L) {
-    realm_object_t **object = (realm_object_t**)lua_touserdata(L, 1);
+    realm_object_t **object = check_handle<realm_object_t>(L, 1, "object");
     if (realm_object_delete(*object)) {
         return 0;
     }
@@ -242,52 +594,54 @@ static int lib_realm_object_delete(lua_State* L) {
 }
 
 static int lib_realm_object_is_valid(lua_State* L) {
-    realm_object_t** object = (realm_object_t**)lua_touserdata(L, 1);
-    lua_pushboolean(L, realm_object_is_valid(*object));
+    // Objects released at the end of a scope are no longer valid either.
+    realm_object_t** object = static_cast<realm_object_t**>(lua_touserdata(L, 1));
+    lua_pushboolean(L, object && *object && realm_object_is_valid(*object));
 
     return 1; 
 }
 
 static int lib_realm_object_get_all(lua_State* L) {
     // Get arguments from the stack.
-    realm_t **realm = (realm_t**)lua_touserdata(L, 1);
-    const char* class_name = lua_tostring(L, 2);
+    realm_t **realm = check_handle<realm_t>(L, 1, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 2);
 
-    // Get class info containing the class key.
-    bool class_found = false;
-    realm_class_info_t class_info;
-    if (!realm_find_class(*realm, class_name, &class_found, &class_info)) {
+    // Get and push the results onto the stack and set its metatable.
+    realm_results_t** results = push_handle<realm_results_t>(L);
+    *results = realm_object_find_all(*realm, class_key);
+    if (!*results) {
         return _inform_realm_error(L);
     }
 
-    if (!class_found) {
-        return _inform_error(L, "Unable to find collection");
-    }
-
-    // Get and push the results onto the stack and set its metatable.
-    realm_results_t** results = static_cast<realm_results_t**>(lua_newuserdata(L, sizeof(realm_results_t*)));
-    luaL_setmetatable(L, RealmHandle);
-    *results = realm_object_find_all(*realm, class_info.key);
-
     return 1;
 }
 
 static int lib_realm_results_get(lua_State* L) {
     // Get arguments from the stack.
-    realm_results_t** realm_results = (realm_results_t**)lua_touserdata(L, 1);
-    int index = lua_tointeger(L, 2);
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    size_t index = lua_tointeger(L, 2);
 
-    // Get and push the realm object onto the stack and set its metatable.
-    realm_object_t** object = static_cast<realm_object_t**>(lua_newuserdata(L, sizeof(realm_object_t*)));
-    luaL_setmetatable(L, RealmHandle);
-    *object = realm_results_get_object(*realm_results, index);
+    // Push a proxy of the object onto the stack, referring to the realm and
+    // class info (3rd and 4th arguments), or nil if out of bounds.
+    try {
+        if (index >= (*realm_results)->size()) {
+            lua_pushnil(L);
+            return 1;
+        }
+        realm::Object object((*realm_results)->get_realm(), (*realm_results)->get<realm::Obj>(index));
+        _push_object_proxy(L, std::move(object), 3, 4);
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
 
-    return 1;
+    return lua_error(L);
 }
 
 static int lib_realm_results_count(lua_State* L) {
     // Get argument from the stack.
-    realm_results_t** realm_results = (realm_results_t**)lua_touserdata(L, 1);
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
 
     // Get the number of objects in the results/collection.
     size_t count;
@@ -302,68 +656,274 @@ static int lib_realm_results_count(lua_State* L) {
     return 1;
 }
 
-static realm_query_t* lib_realm_query_parse(lua_State* L, realm_t *realm, const char* class_name, const char* query_string, size_t num_args, size_t lua_arg_offset) {
-    // The start location of arguments on the stack.
-    int arg_index;
-
-    // Set up 2d vector to contain all realm_arguments provided.
-    std::vector<realm_query_arg_t> args_vector;
-    std::vector<std::vector<realm_value_t>> value;
-    for (int index = 0; index < num_args; index++) {
-        std::vector<realm_value_t>& realm_values = value.emplace_back();
-        arg_index = lua_arg_offset + index;
-        std::optional<realm_value_t> value = lua_to_realm_value(L, arg_index);
-        if (!value) {
-            // Unknown value provided.
-            return nullptr;
+// A cursor over results which keeps its position between calls. It starts
+// with the handle of the results so it can be released like any other handle.
+struct realm_results_cursor {
+    realm_lua_handle handle;
+    size_t position;
+};
+
+static int lib_realm_results_iter(lua_State* L) {
+    // Get argument from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+
+    // Create and push the cursor onto the stack and set its metatable.
+    auto* cursor = reinterpret_cast<realm_results_cursor*>(push_handle_node(L, sizeof(realm_results_cursor)));
+    cursor->handle.value = realm_clone(*realm_results);
+    cursor->position = 0;
+
+    return 1;
+}
+
+static int lib_realm_results_iter_next(lua_State* L) {
+    // Get arguments from the stack.
+    auto* cursor = static_cast<realm_results_cursor*>(luaL_checkudata(L, 1, RealmHandle));
+    luaL_checktype(L, 2, LUA_TTABLE);
+    size_t chunk_size = luaL_checkinteger(L, 3);
+
+    // Fill the chunk table (2nd argument) with proxies of the next objects,
+    // referring to the realm and class info (4th and 5th arguments).
+    try {
+        realm::Results& results = *static_cast<realm_results_t*>(cursor->handle.value);
+        size_t count = results.size();
+        size_t num_fetched = 0;
+        while (num_fetched < chunk_size && cursor->position < count) {
+            realm::Object object(results.get_realm(), results.get<realm::Obj>(cursor->position));
+            _push_object_proxy(L, std::move(object), 4, 5);
+            lua_rawseti(L, 2, ++num_fetched);
+            cursor->position++;
         }
-        realm_values.emplace_back(*value);
-        args_vector.emplace_back(realm_query_arg_t {
-            .nb_args = 1,
-            .is_list = false,
-            .arg = realm_values.data(),
-        });
+
+        // Push the number of objects fetched, 0 when the cursor is exhausted.
+        lua_pushinteger(L, num_fetched);
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
     }
-    // Set array value here from vector.
 
-    // Get class key.
-    bool class_found = false;
-    realm_class_info_t class_info;
-    if (!realm_find_class(realm, class_name, &class_found, &class_info)) {
-        _inform_realm_error(L);
-        return nullptr;
+    return lua_error(L);
+}
+
+static void push_column_value(lua_State* L, int64_t value) {
+    lua_pushinteger(L, value);
+}
+
+static void push_column_value(lua_State* L, bool value) {
+    lua_pushboolean(L, value);
+}
+
+static void push_column_value(lua_State* L, float value) {
+    lua_pushnumber(L, value);
+}
+
+static void push_column_value(lua_State* L, double value) {
+    lua_pushnumber(L, value);
+}
+
+static void push_column_value(lua_State* L, realm::StringData value) {
+    lua_pushlstring(L, value.data(), value.size());
+}
+
+// Fill the table on top of the stack with the values of a column, reading
+// them directly from the table view. Null values are left as holes.
+template <typename T>
+static void push_column_values(lua_State* L, realm::TableView& table_view, realm::ColKey column, bool nullable) {
+    size_t size = table_view.size();
+    for (size_t index = 0; index < size; index++) {
+        realm::Obj object = table_view.get_object(index);
+        if (nullable && object.is_null(column)) {
+            continue;
+        }
+        push_column_value(L, object.get<T>(column));
+        lua_rawseti(L, -2, index + 1);
+    }
+}
+
+static void push_link_column_values(lua_State* L, realm_t* realm, realm::TableView& table_view, realm::ColKey column, realm::TableKey target_table) {
+    size_t size = table_view.size();
+    for (size_t index = 0; index < size; index++) {
+        realm::ObjKey target = table_view.get_object(index).get<realm::ObjKey>(column);
+        if (!target) {
+            continue;
+        }
+        realm_object_t** object = push_handle<realm_object_t>(L);
+        *object = realm_get_object(realm, target_table.value, target.value);
+        lua_rawseti(L, -2, index + 1);
+    }
+}
+
+static int lib_realm_results_get_column(lua_State* L) {
+    // Get arguments from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 4)));
+
+    realm_property_info_t property_info;
+    if (!realm_get_property(*realm, class_key, property_key, &property_info)) {
+        return _inform_realm_error(L);
+    }
+    if (property_info.collection_type != RLM_COLLECTION_TYPE_NONE) {
+        return _inform_error(L, "Cannot read the column of collection property '%1'", property_info.name);
+    }
+    switch (property_info.type) {
+        case RLM_PROPERTY_TYPE_INT:
+        case RLM_PROPERTY_TYPE_BOOL:
+        case RLM_PROPERTY_TYPE_STRING:
+        case RLM_PROPERTY_TYPE_FLOAT:
+        case RLM_PROPERTY_TYPE_DOUBLE:
+        case RLM_PROPERTY_TYPE_OBJECT:
+            break;
+        default:
+            return _inform_error(L, "Cannot read the column of property '%1' of this type", property_info.name);
+    }
+    bool nullable = property_info.flags & RLM_PROPERTY_NULLABLE;
+
+    // Push a table of the values and their count onto the stack, with the
+    // type of the column resolved once rather than for every value.
+    try {
+        realm::TableView table_view = (*realm_results)->get_tableview();
+        realm::ColKey column(property_key);
+        lua_createtable(L, table_view.size(), 0);
+        switch (property_info.type) {
+            case RLM_PROPERTY_TYPE_INT:
+                push_column_values<int64_t>(L, table_view, column, nullable);
+                break;
+            case RLM_PROPERTY_TYPE_BOOL:
+                push_column_values<bool>(L, table_view, column, nullable);
+                break;
+            case RLM_PROPERTY_TYPE_STRING:
+                push_column_values<realm::StringData>(L, table_view, column, nullable);
+                break;
+            case RLM_PROPERTY_TYPE_FLOAT:
+                push_column_values<float>(L, table_view, column, nullable);
+                break;
+            case RLM_PROPERTY_TYPE_DOUBLE:
+                push_column_values<double>(L, table_view, column, nullable);
+                break;
+            default: {
+                realm::TableKey target_table = (*realm_results)->get_table()->get_link_target(column)->get_key();
+                push_link_column_values(L, *realm, table_view, column, target_table);
+                break;
+            }
+        }
+        lua_pushinteger(L, table_view.size());
+
+        return 2;
     }
-    if (!class_found) {
-        _inform_error(L, "Unable to find collection");
-        return nullptr;
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
     }
 
-    return realm_query_parse(realm, class_info.key, query_string, num_args, args_vector.data()); 
+    return lua_error(L);
 }
 
-static int lib_realm_results_filter(lua_State *L) {
-    // Get the arguments from the stack.
-    realm_results_t** unfiltered_result = (realm_results_t**)lua_touserdata(L, 1);
-    realm_t** realm = (realm_t**)lua_touserdata(L, 2);
-    const char* class_name = lua_tostring(L, 3);
-    const char* query_string = lua_tostring(L, 4);
-    size_t num_args = lua_tointeger(L, 5);
+// Compute an aggregate over a property of the results and push it onto
+// the stack, or nil if there were no values to aggregate.
+template <typename Aggregate>
+static int results_aggregate(lua_State* L, Aggregate aggregate) {
+    // Get arguments from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
+    realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 3)));
 
-    // Parse the query string.
-    size_t lua_arg_offset = 6;
-    realm_query_t* query = lib_realm_query_parse(L, *realm, class_name, query_string, num_args, lua_arg_offset);
-    if (!query) {
+    realm_value_t out_value;
+    bool found = false;
+    if (!aggregate(*realm_results, property_key, &out_value, &found)) {
         return _inform_realm_error(L);
     }
+    if (!found) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    return realm_to_lua_value(L, *realm, out_value);
+}
+
+static int lib_realm_results_sum(lua_State* L) {
+    return results_aggregate(L, realm_results_sum);
+}
+
+static int lib_realm_results_min(lua_State* L) {
+    return results_aggregate(L, realm_results_min);
+}
+
+static int lib_realm_results_max(lua_State* L) {
+    return results_aggregate(L, realm_results_max);
+}
+
+static int lib_realm_results_average(lua_State* L) {
+    return results_aggregate(L, realm_results_average);
+}
+
+// Push new results derived from existing ones onto the stack and set its metatable.
+template <typename Derive>
+static int push_derived_results(lua_State* L, Derive derive) {
+    realm_results_t** results = push_handle<realm_results_t>(L);
+    *results = nullptr;
+    try {
+        *results = new realm_results_t(derive());
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int lib_realm_results_sort(lua_State* L) {
+    // Get arguments from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    luaL_checktype(L, 2, LUA_TTABLE);
+    luaL_checktype(L, 3, LUA_TTABLE);
+
+    // Pair every key path (2nd argument) with whether to sort it in ascending order (3rd argument).
+    size_t num_key_paths = lua_rawlen(L, 2);
+    std::vector<std::pair<std::string, bool>> key_paths;
+    key_paths.reserve(num_key_paths);
+    for (size_t index = 1; index <= num_key_paths; index++) {
+        lua_rawgeti(L, 2, index);
+        lua_rawgeti(L, 3, index);
+        key_paths.emplace_back(lua_tostringview(L, -2), lua_toboolean(L, -1));
+        lua_pop(L, 2);
+    }
 
-    // Get and push the filtered result onto the stack and set its metatable.
-    realm_results_t** result = static_cast<realm_results_t**>(lua_newuserdata(L, sizeof(realm_results_t*)));
-    luaL_setmetatable(L, RealmHandle);
-    *result = realm_results_filter(*unfiltered_result, query);
+    return push_derived_results(L, [&] {
+        return (*realm_results)->sort(key_paths);
+    });
+}
 
-    return 1;
+static int lib_realm_results_distinct(lua_State* L) {
+    // Get arguments from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    size_t num_key_paths = lua_rawlen(L, 2);
+    std::vector<std::string> key_paths;
+    key_paths.reserve(num_key_paths);
+    for (size_t index = 1; index <= num_key_paths; index++) {
+        lua_rawgeti(L, 2, index);
+        key_paths.emplace_back(lua_tostringview(L, -1));
+        lua_pop(L, 1);
+    }
+
+    return push_derived_results(L, [&] {
+        return (*realm_results)->distinct(key_paths);
+    });
 }
 
+static int lib_realm_results_limit(lua_State* L) {
+    // Get arguments from the stack.
+    realm_results_t** realm_results = check_handle<realm_results_t>(L, 1, "results");
+    lua_Integer max_count = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, max_count >= 0, 2, "limit must not be negative");
+
+    return push_derived_results(L, [&] {
+        return (*realm_results)->limit(max_count);
+    });
+}
 
 static int lib_realm_list_insert(lua_State *L) {
     // Get arguments from the stack.
@@ -372,7 +932,7 @@ static int lib_realm_list_insert(lua_State *L) {
         _inform_error(L, "No corresponding realm value found");
         return 0;
     }
-    realm_list_t** realm_list = (realm_list_t**)lua_touserdata(L, 1);
+    realm_list_t** realm_list = check_handle<realm_list_t>(L, 1, "list");
     size_t index = lua_tointeger(L, 2);
 
     // Get size of list.
@@ -401,8 +961,8 @@ static int lib_realm_list_insert(lua_State *L) {
 
 static int lib_realm_list_get(lua_State *L) {
     // Get arguments from the stack.
-    realm_list_t** realm_list = (realm_list_t**)lua_touserdata(L, 1);
-    realm_t** realm = (realm_t**)lua_touserdata(L, 2);
+    realm_list_t** realm_list = check_handle<realm_list_t>(L, 1, "list");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
     size_t index = lua_tointeger(L, 3);
 
     // Get value from list.
@@ -417,7 +977,7 @@ static int lib_realm_list_get(lua_State *L) {
 
 static int lib_realm_list_size(lua_State *L) {
     // Get arguments from the stack.
-    realm_list_t** realm_list = (realm_list_t**)lua_touserdata(L, 1);
+    realm_list_t** realm_list = check_handle<realm_list_t>(L, 1, "list");
 
     // Get size of list and push onto the stack.
     size_t out_size;
@@ -432,7 +992,7 @@ static int lib_realm_list_size(lua_State *L) {
 static int lib_realm_list_erase(lua_State *L)
 {
     // Get arguments from the stack.
-    realm_list_t** realm_list = (realm_list_t**)lua_touserdata(L, 1);
+    realm_list_t** realm_list = check_handle<realm_list_t>(L, 1, "list");
     size_t index = lua_tointeger(L, 2);
 
     if (!realm_list_erase(*realm_list, index))
@@ -444,12 +1004,11 @@ static int lib_realm_list_erase(lua_State *L)
 
 static int lib_realm_get_list(lua_State *L) {
     // Get arguments from the stack.
-    realm_object_t** realm_object = (realm_object_t**)lua_touserdata(L, 1);
+    realm_object_t** realm_object = check_handle<realm_object_t>(L, 1, "object");
     realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 2)));
 
     // Get and push the list onto the stack and set its metatable.
-    realm_list_t** realm_list = static_cast<realm_list_t**>(lua_newuserdata(L, sizeof(realm_list_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_list_t** realm_list = push_handle<realm_list_t>(L);
     *realm_list = realm_get_list(*realm_object, property_key);
 
     return 1;
@@ -457,12 +1016,11 @@ static int lib_realm_get_list(lua_State *L) {
 
 static int lib_realm_get_dictionary(lua_State *L) {
     // Get arguments from the stack.
-    realm_object_t** realm_object = (realm_object_t**)lua_touserdata(L, 1);
+    realm_object_t** realm_object = check_handle<realm_object_t>(L, 1, "object");
     realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 2)));
 
     // Get and push the list onto the stack and set its metatable.
-    realm_dictionary_t** realm_dictionary = static_cast<realm_dictionary_t**>(lua_newuserdata(L, sizeof(realm_dictionary_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_dictionary_t** realm_dictionary = push_handle<realm_dictionary_t>(L);
     *realm_dictionary = realm_get_dictionary(*realm_object, property_key);
 
     return 1;
@@ -470,9 +1028,9 @@ static int lib_realm_get_dictionary(lua_State *L) {
 
 static int lib_realm_dictionary_find(lua_State *L) {
     // Get arguments from the stack.
-    realm_dictionary_t** realm_dictionary = (realm_dictionary_t**)lua_touserdata(L, 1);
+    realm_dictionary_t** realm_dictionary = check_handle<realm_dictionary_t>(L, 1, "dictionary");
     auto key = lua_to_realm_value(L, 2);
-    realm_t **realm = (realm_t**)lua_touserdata(L, 3);
+    realm_t **realm = check_handle<realm_t>(L, 3, "realm");
 
     realm_value_t out_value;
     if (!realm_dictionary_find(*realm_dictionary, *key, &out_value, nullptr)) {
@@ -486,7 +1044,7 @@ static int lib_realm_dictionary_find(lua_State *L) {
 
 static int lib_realm_dictionary_size(lua_State *L) {
     // Get arguments from the stack.
-    realm_dictionary_t** realm_dictionary = (realm_dictionary_t**)lua_touserdata(L, 1);
+    realm_dictionary_t** realm_dictionary = check_handle<realm_dictionary_t>(L, 1, "dictionary");
 
     // Get size of list and push onto the stack.
     size_t out_size;
@@ -501,12 +1059,11 @@ static int lib_realm_dictionary_size(lua_State *L) {
 static int lib_realm_get_set(lua_State *L)
 {
     // Get arguments from the stack.
-    realm_object_t **realm_object = (realm_object_t **)lua_touserdata(L, 1);
+    realm_object_t **realm_object = check_handle<realm_object_t>(L, 1, "object");
     realm_property_key_t &property_key = *(static_cast<realm_property_key_t *>(lua_touserdata(L, 2)));
 
     // Get and push the set onto the stack and set its metatable.
-    realm_set_t **realm_set = static_cast<realm_set_t **>(lua_newuserdata(L, sizeof(realm_list_t *)));
-    luaL_setmetatable(L, RealmHandle);
+    realm_set_t ** realm_set = push_handle<realm_set_t>(L);
     *realm_set = realm_get_set(*realm_object, property_key);
     if (!*realm_set)
     {
@@ -519,7 +1076,7 @@ static int lib_realm_get_set(lua_State *L)
 static int lib_realm_set_insert(lua_State *L)
 {
     std::optional<realm_value_t> value = lua_to_realm_value(L, 2);
-    realm_set_t **realm_set = (realm_set_t **)lua_touserdata(L, 1);
+    realm_set_t **realm_set = check_handle<realm_set_t>(L, 1, "set");
 
     if (!realm_set_insert(*realm_set, *value, NULL, NULL))
     {
@@ -532,7 +1089,7 @@ static int lib_realm_set_insert(lua_State *L)
 static int lib_realm_set_size(lua_State *L)
 {
     // Get arguments from the stack.
-    realm_set_t **realm_set = (realm_set_t **)lua_touserdata(L, 1);
+    realm_set_t **realm_set = check_handle<realm_set_t>(L, 1, "set");
 
     // Get size of list and push onto the stack.
     size_t out_size;
@@ -551,7 +1108,7 @@ static int lib_realm_dictionary_insert(lua_State *L) {
         _inform_error(L, "No corresponding realm value found");
         return 0;
     }
-    realm_dictionary_t** realm_dictionary = (realm_dictionary_t**)lua_touserdata(L, 1);
+    realm_dictionary_t** realm_dictionary = check_handle<realm_dictionary_t>(L, 1, "dictionary");
     std::optional<realm_value_t> index = lua_to_realm_value(L, 2);
     bool success = realm_dictionary_insert(*realm_dictionary, *index, *value, nullptr, nullptr);
     if (!success) {
@@ -563,7 +1120,7 @@ static int lib_realm_dictionary_insert(lua_State *L) {
 
 static int lib_realm_dictionary_erase(lua_State *L) {
     // Get arguments from the stack.
-    realm_dictionary_t** realm_dictionary = (realm_dictionary_t**)lua_touserdata(L, 1);
+    realm_dictionary_t** realm_dictionary = check_handle<realm_dictionary_t>(L, 1, "dictionary");
     auto key = lua_to_realm_value(L, 2);
     bool success = realm_dictionary_erase(*realm_dictionary, *key, nullptr);
     if (!success) {
@@ -576,7 +1133,7 @@ static int lib_realm_dictionary_erase(lua_State *L) {
 static int lib_realm_set_erase(lua_State *L)
 {
     // Get arguments from the stack.
-    realm_set_t **realm_set = (realm_set_t **)lua_touserdata(L, 1);
+    realm_set_t **realm_set = check_handle<realm_set_t>(L, 1, "set");
     std::optional<realm_value_t> value = lua_to_realm_value(L, 2);
 
     // Get size of list and push onto the stack.
@@ -592,7 +1149,7 @@ static int lib_realm_set_erase(lua_State *L)
 static int lib_realm_set_find(lua_State *L)
 {
     // Get arguments from the stack.
-    realm_set_t **realm_set = (realm_set_t **)lua_touserdata(L, 1);
+    realm_set_t **realm_set = check_handle<realm_set_t>(L, 1, "set");
     std::optional<realm_value_t> value = lua_to_realm_value(L, 2);
     bool out_found;
     if (!realm_set_find(*realm_set, *value, nullptr, &out_found))
@@ -606,21 +1163,58 @@ static int lib_realm_set_find(lua_State *L)
 static const luaL_Reg lib[] = {
   {"realm_open",                                lib_realm_open},
   {"realm_release",                             lib_realm_release},
+  {"realm_close",                               lib_realm_close},
+  {"realm_disable_sync_to_disk",                lib_realm_disable_sync_to_disk},
+  {"realm_track_handle",                        lib_realm_track_handle},
+  {"realm_release_handles",                     lib_realm_release_handles},
+  {"realm_scope_begin",                         lib_realm_scope_begin},
+  {"realm_scope_end",                           lib_realm_scope_end},
   {"realm_begin_write",                         lib_realm_begin_write},
   {"realm_commit_transaction",                  lib_realm_commit_transaction},
   {"realm_cancel_transaction",                  lib_realm_cancel_transaction},
+  {"realm_async_write",                         lib_realm_async_write},
+  {"realm_freeze",                              lib_realm_freeze},
+  {"realm_results_resolve_in",                  lib_realm_results_resolve_in},
+  {"realm_object_resolve_in",                   lib_realm_object_resolve_in},
+  {"realm_export_frozen",                       lib_realm_export_frozen},
+  {"realm_import_frozen",                       lib_realm_import_frozen},
+  {"realm_refresh",                             lib_realm_refresh},
+  {"realm_create_thread_safe_reference",        lib_realm_create_thread_safe_reference},
+  {"realm_object_from_thread_safe_reference",   lib_realm_object_from_thread_safe_reference},
+  {"realm_results_from_thread_safe_reference",  lib_realm_results_from_thread_safe_reference},
   {"realm_object_create",                       lib_realm_object_create},
+  {"realm_object_to_proxy",                     lib_realm_object_to_proxy},
+  {"realm_object_get_view",                     lib_realm_object_get_view},
+  {"realm_object_read_blob",                    lib_realm_object_read_blob},
+  {"realm_object_write_blob",                   lib_realm_object_write_blob},
   {"realm_object_create_with_primary_key",      lib_realm_object_create_with_primary_key},
+  {"realm_object_create_many",                  lib_realm_object_create_many},
+  {"realm_import",                              lib_realm_import},
   {"realm_object_delete",                       lib_realm_object_delete},
   {"realm_set_value",                           lib_realm_set_value},
   {"realm_get_value",                           lib_realm_get_value},
+  {"realm_get_values",                          lib_realm_get_values},
   {"realm_object_is_valid",                     lib_realm_object_is_valid},
   {"realm_object_get_all",                      lib_realm_object_get_all},
   {"realm_object_add_listener",                 lib_realm_object_add_listener},
   {"realm_results_get",                         lib_realm_results_get},
   {"realm_results_count",                       lib_realm_results_count},
+  {"realm_results_iter",                        lib_realm_results_iter},
+  {"realm_results_get_column",                  lib_realm_results_get_column},
+  {"realm_results_sum",                         lib_realm_results_sum},
+  {"realm_results_min",                         lib_realm_results_min},
+  {"realm_results_max",                         lib_realm_results_max},
+  {"realm_results_average",                     lib_realm_results_average},
+  {"realm_results_sort",                        lib_realm_results_sort},
+  {"realm_results_distinct",                    lib_realm_results_distinct},
+  {"realm_results_limit",                       lib_realm_results_limit},
+  {"realm_results_iter_next",                   lib_realm_results_iter_next},
   {"realm_results_add_listener",                lib_realm_results_add_listener},
   {"realm_results_filter",                      lib_realm_results_filter},
+  {"realm_query_find_all",                      lib_realm_query_find_all},
+  {"realm_query_prepare",                       lib_realm_query_prepare},
+  {"realm_query_cache_new",                     lib_realm_query_cache_new},
+  {"realm_query_cache_clear",                   lib_realm_query_cache_clear},
   {"realm_list_insert",                         lib_realm_list_insert},
   {"realm_list_get",                            lib_realm_list_get},
   {"realm_list_size",                           lib_realm_list_size},
@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <realm.h>
+
+#include "realm_native_scheduler.hpp"
+#include "realm_util.hpp"
+#include "realm_work_queue.hpp"
+
+#include <realm/object-store/c_api/types.hpp>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#endif
+
+namespace native_loop {
+
+#if !defined(_WIN32)
+
+static const char* LoopMeta = "realm_scheduler_native_loop";
+
+// The work queue of a loop, woken up through an eventfd on Linux or a
+// self-pipe elsewhere, which the host can poll along with its own fds.
+class PollWorkQueue : public WorkQueue {
+public:
+    PollWorkQueue() {
+#if defined(__linux__)
+        m_read_fd = m_write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_read_fd < 0) {
+            throw std::system_error(errno, std::system_category(), "Could not create the eventfd of the loop");
+        }
+#else
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw std::system_error(errno, std::system_category(), "Could not create the pipe of the loop");
+        }
+        for (int fd : fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        m_read_fd = fds[0];
+        m_write_fd = fds[1];
+#endif
+    }
+
+    ~PollWorkQueue() {
+        close(m_read_fd);
+        if (m_write_fd != m_read_fd) {
+            close(m_write_fd);
+        }
+    }
+
+    virtual void wake() final {
+        // A full pipe or counter means the loop is already woken up.
+#if defined(__linux__)
+        uint64_t value = 1;
+        [[maybe_unused]] ssize_t written = write(m_write_fd, &value, sizeof(value));
+#else
+        char value = 1;
+        [[maybe_unused]] ssize_t written = write(m_write_fd, &value, sizeof(value));
+#endif
+    }
+
+    // Wait until woken up or the timeout in milliseconds (-1 to wait forever)
+    // has passed, and reset the fd. Returns whether it was woken up.
+    bool wait(int timeout) {
+        pollfd poll_fd{m_read_fd, POLLIN, 0};
+        int ready = poll(&poll_fd, 1, timeout);
+        if (ready <= 0) {
+            return false;
+        }
+        char buffer[64];
+        while (read(m_read_fd, buffer, sizeof(buffer)) > 0) {
+        }
+
+        return true;
+    }
+
+    int fd() const {
+        return m_read_fd;
+    }
+
+private:
+    int m_read_fd;
+    int m_write_fd;
+};
+
+static std::shared_ptr<PollWorkQueue>& check_loop(lua_State* L, int index) {
+    return *static_cast<std::shared_ptr<PollWorkQueue>*>(luaL_checkudata(L, index, LoopMeta));
+}
+
+static int create_loop(lua_State* L) {
+    auto loop = static_cast<std::shared_ptr<PollWorkQueue>*>(lua_newuserdatauv(L, sizeof(std::shared_ptr<PollWorkQueue>), 0));
+    try {
+        new (loop) std::shared_ptr<PollWorkQueue>(std::make_shared<PollWorkQueue>());
+        luaL_setmetatable(L, LoopMeta);
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int create_scheduler(lua_State* L) {
+    std::shared_ptr<PollWorkQueue>& loop = check_loop(L, 1);
+    WorkQueue::Lane lane = WorkQueue::check_lane(L, 2);
+
+    auto scheduler = push_handle<realm_scheduler_t>(L);
+    *scheduler = new realm_scheduler_t(std::make_shared<QueueScheduler>(loop, lane));
+
+    return 1;
+}
+
+static int loop_gc(lua_State* L) {
+    check_loop(L, 1).~shared_ptr();
+
+    return 0;
+}
+
+static int loop_wait(lua_State* L) {
+    std::shared_ptr<PollWorkQueue>& loop = check_loop(L, 1);
+    lua_pushboolean(L, loop->wait(luaL_optinteger(L, 2, -1)));
+
+    return 1;
+}
+
+static int loop_wake(lua_State* L) {
+    check_loop(L, 1)->wake();
+
+    return 0;
+}
+
+static int loop_do_work(lua_State* L) {
+    return check_loop(L, 1)->invoke(L, 2);
+}
+
+static int loop_fd(lua_State* L) {
+    lua_pushinteger(L, check_loop(L, 1)->fd());
+
+    return 1;
+}
+
+static int loop_has_schedulers(lua_State* L) {
+    lua_pushboolean(L, check_loop(L, 1)->has_schedulers());
+
+    return 1;
+}
+
+static int now(lua_State* L) {
+    // Push the time of the monotonic clock in milliseconds.
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    lua_pushnumber(L, std::chrono::duration<lua_Number, std::milli>(time).count());
+
+    return 1;
+}
+
+extern "C" int luaopen_realm_scheduler_native_native(lua_State* L) {
+    luaL_Reg loop_meta[] = {
+        {"__gc", loop_gc},
+        {NULL, NULL}
+    };
+    luaL_newmetatable(L, LoopMeta);
+    luaL_setfuncs(L, loop_meta, 0);
+
+    luaL_Reg loop_funcs[] {
+        {"wait", loop_wait},
+        {"wake", loop_wake},
+        {"do_work", loop_do_work},
+        {"fd", loop_fd},
+        {"has_schedulers", loop_has_schedulers},
+        {NULL, NULL}
+    };
+    luaL_newlib(L, loop_funcs);
+    lua_setfield(L, -2, "__index");
+
+    lua_pop(L, 1); // pop the loop metatable
+
+    luaL_Reg funcs[] = {
+        {"create_loop", create_loop},
+        {"create_scheduler", create_scheduler},
+        {"now", now},
+        {NULL, NULL}
+    };
+    luaL_newlib(L, funcs);
+
+    return 1;
+}
+
+#else
+
+extern "C" int luaopen_realm_scheduler_native_native(lua_State* L) {
+    return _inform_error(L, "The native scheduler is not supported on Windows, use realm.scheduler.libuv instead.");
+}
+
+#endif
+
+}
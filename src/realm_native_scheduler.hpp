@@ -0,0 +1,3 @@
+#include <lua.hpp>
+
+extern "C" int luaopen_realm_scheduler_native_native(lua_State*);
@@ -1,7 +1,16 @@
 #define realm_userdata_t struct realm_lua_userdata*
 
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <realm.h>
-//#include <realm/object-store/c_api/types.hpp>
+#include <realm/object-store/c_api/types.hpp>
+#include <realm/object-store/collection_notifications.hpp>
+#include <realm/object-store/impl/collection_change_builder.hpp>
 #include "realm_util.hpp"
 #include "realm_notifications.hpp"
 
@@ -28,100 +37,441 @@ static void populate_lua_object_changes_table(lua_State* L, int table_index, con
     lua_setfield(L, table_index, field_name);
 }
 
-static void on_object_change(realm_lua_userdata* userdata, const realm_object_changes_t* changes) {
-    // Get the modified properties only if the object was not deleted.
-    size_t num_modified_properties = realm_object_changes_get_num_modified_properties(changes);
-    realm_property_key_t modified_properties[num_modified_properties];
-    bool object_is_deleted = realm_object_changes_is_deleted(changes);
-    if (!object_is_deleted) {
-        realm_object_changes_get_modified_properties(changes, modified_properties, num_modified_properties);
-    }
-
-    lua_State* L = userdata->L;
-
-    // Get the Lua callback function from the register and put onto the stack.
-    lua_rawgeti(L, LUA_REGISTRYINDEX, userdata->callback_reference);
-
+// Push a table of the changes of an object onto the stack
+// ({ isDeleted: <bool>, modifiedProperties: <modified_properties> }).
+static void push_object_changes(lua_State* L, bool is_deleted, realm_property_key_t* modified_properties, size_t num_modified_properties) {
     // TODO:
     // Get schema from userdata and pass an array of the property strings to populate_lua_object_changes_table
-
-    // Push a new table onto the stack and add isDeleted and modifiedProperties
-    // ({ isDeleted: <bool>, modifiedProperties: <modified_properties> }).
     lua_newtable(L);
     int table_index = lua_gettop(L);
-    lua_pushboolean(L, object_is_deleted);
+    lua_pushboolean(L, is_deleted);
     lua_setfield(L, table_index, "isDeleted");
     populate_lua_object_changes_table(L, table_index, "modifiedProperties", modified_properties, num_modified_properties);
+}
+
+static const char* CollectionChangesMeta = "_realm_collection_changes";
+static const char* IndexListMeta = "_realm_index_list";
+
+enum ChangeKind {
+    Deletions,
+    Insertions,
+    ModificationsOld,
+    ModificationsNew,
+    NumChangeKinds
+};
+
+static const char* change_kind_names[NumChangeKinds] = {
+    "deletions",
+    "insertions",
+    "modificationsOld",
+    "modificationsNew"
+};
+
+// The ranges of the indices of one kind of change, and the number of
+// indices before each range.
+struct ChangeRanges {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    std::vector<size_t> offsets;
+    size_t count;
+    bool is_loaded;
+};
+
+// The changes passed to a collection listener. One is created per listener
+// and reused for every notification. The ranges of a kind of change are only
+// read when first accessed, into buffers which are reused between notifications.
+struct CollectionChanges {
+    // The changes being notified, or null outside of the callback.
+    const realm::CollectionChangeSet* changes;
+    unsigned generation;
+    ChangeRanges kinds[NumChangeKinds];
+};
+
+// A lazy array of the indices of one kind of change.
+struct IndexList {
+    CollectionChanges* changes;
+    unsigned generation;
+    int kind;
+};
+
+static const realm::IndexSet& get_index_set(const realm::CollectionChangeSet& changes, int kind) {
+    switch (kind) {
+        case Deletions:         return changes.deletions;
+        case Insertions:        return changes.insertions;
+        case ModificationsOld:  return changes.modifications;
+        default:                return changes.modifications_new;
+    }
+}
+
+// Get the ranges of a kind of change, reading them from the changes the first time.
+static const ChangeRanges& get_change_ranges(CollectionChanges& collection_changes, int kind) {
+    ChangeRanges& ranges = collection_changes.kinds[kind];
+    if (!ranges.is_loaded) {
+        ranges.ranges.clear();
+        ranges.offsets.clear();
+        ranges.count = 0;
+        for (auto range : get_index_set(*collection_changes.changes, kind)) {
+            ranges.ranges.push_back(range);
+            ranges.offsets.push_back(ranges.count);
+            ranges.count += range.second - range.first;
+        }
+        ranges.is_loaded = true;
+    }
+
+    return ranges;
+}
+
+static CollectionChanges& check_changes(lua_State* L, int index) {
+    auto* collection_changes = static_cast<CollectionChanges*>(luaL_checkudata(L, index, CollectionChangesMeta));
+    if (!collection_changes->changes) {
+        _inform_error(L, "The changes can only be read within the listener");
+    }
+
+    return *collection_changes;
+}
+
+static const ChangeRanges& check_index_list(lua_State* L, int index) {
+    auto* list = static_cast<IndexList*>(luaL_checkudata(L, index, IndexListMeta));
+    if (!list->changes->changes || list->changes->generation != list->generation) {
+        _inform_error(L, "The changes can only be read within the listener");
+    }
+
+    return get_change_ranges(*list->changes, list->kind);
+}
+
+static int index_list_len(lua_State* L) {
+    lua_pushinteger(L, check_index_list(L, 1).count);
+
+    return 1;
+}
+
+static int index_list_index(lua_State* L) {
+    // Find the range holding the (1-based) position and push the (1-based)
+    // index at that position, or nil if out of bounds.
+    const ChangeRanges& ranges = check_index_list(L, 1);
+    lua_Integer position = lua_tointeger(L, 2);
+    if (position < 1 || static_cast<size_t>(position) > ranges.count) {
+        lua_pushnil(L);
+        return 1;
+    }
+    size_t offset = position - 1;
+    auto it = std::upper_bound(ranges.offsets.begin(), ranges.offsets.end(), offset) - 1;
+    size_t range_index = it - ranges.offsets.begin();
+    lua_pushinteger(L, ranges.ranges[range_index].first + (offset - *it) + 1);
+
+    return 1;
+}
+
+static int changes_gc(lua_State* L) {
+    auto* collection_changes = static_cast<CollectionChanges*>(luaL_checkudata(L, 1, CollectionChangesMeta));
+    collection_changes->~CollectionChanges();
+
+    return 0;
+}
+
+static int change_ranges_next(lua_State* L) {
+    // Upvalues: the changes, the kind, the generation and the position of the next range.
+    auto* collection_changes = static_cast<CollectionChanges*>(lua_touserdata(L, lua_upvalueindex(1)));
+    int kind = lua_tointeger(L, lua_upvalueindex(2));
+    unsigned generation = lua_tointeger(L, lua_upvalueindex(3));
+    size_t position = lua_tointeger(L, lua_upvalueindex(4));
+    if (!collection_changes->changes || collection_changes->generation != generation) {
+        return _inform_error(L, "The changes can only be read within the listener");
+    }
+    const ChangeRanges& ranges = get_change_ranges(*collection_changes, kind);
+    if (position >= ranges.ranges.size()) {
+        return 0;
+    }
+    lua_pushinteger(L, position + 1);
+    lua_replace(L, lua_upvalueindex(4));
+
+    // Push the first and last (1-based) indices of the range.
+    lua_pushinteger(L, ranges.ranges[position].first + 1);
+    lua_pushinteger(L, ranges.ranges[position].second);
+
+    return 2;
+}
+
+// Push an iterator over the ranges of a kind of change, yielding the first
+// and last index of each range.
+template <int kind>
+static int changes_ranges(lua_State* L) {
+    CollectionChanges& collection_changes = check_changes(L, 1);
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, kind);
+    lua_pushinteger(L, collection_changes.generation);
+    lua_pushinteger(L, 0);
+    lua_pushcclosure(L, change_ranges_next, 4);
+
+    return 1;
+}
+
+static int changes_index(lua_State* L) {
+    // Push a lazy array of the indices of a kind of change.
+    CollectionChanges& collection_changes = check_changes(L, 1);
+    std::string_view key = lua_tostringview(L, 2);
+    for (int kind = 0; kind < NumChangeKinds; kind++) {
+        if (key == change_kind_names[kind]) {
+            auto* list = static_cast<IndexList*>(lua_newuserdatauv(L, sizeof(IndexList), 1));
+            *list = IndexList{&collection_changes, collection_changes.generation, kind};
+            // Keep the changes alive as long as the list.
+            lua_pushvalue(L, 1);
+            lua_setiuservalue(L, -2, 1);
+            luaL_setmetatable(L, IndexListMeta);
+            return 1;
+        }
+    }
+
+    // Otherwise push the method of that name (upvalue 1), if any.
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(1));
+
+    return 1;
+}
+
+// Create and push the changes of a collection listener onto the stack.
+static void push_collection_changes(lua_State* L) {
+    auto* collection_changes = static_cast<CollectionChanges*>(lua_newuserdatauv(L, sizeof(CollectionChanges), 0));
+    new (collection_changes) CollectionChanges{};
+
+    if (luaL_newmetatable(L, CollectionChangesMeta)) {
+        lua_pushcfunction(L, changes_gc);
+        lua_setfield(L, -2, "__gc");
+
+        const luaL_Reg methods[] = {
+            {"deletionRanges",          changes_ranges<Deletions>},
+            {"insertionRanges",         changes_ranges<Insertions>},
+            {"modificationOldRanges",   changes_ranges<ModificationsOld>},
+            {"modificationNewRanges",   changes_ranges<ModificationsNew>},
+            {NULL, NULL}
+        };
+        luaL_newlib(L, methods);
+        lua_pushcclosure(L, changes_index, 1);
+        lua_setfield(L, -2, "__index");
+
+        luaL_newmetatable(L, IndexListMeta);
+        lua_pushcfunction(L, index_list_len);
+        lua_setfield(L, -2, "__len");
+        lua_pushcfunction(L, index_list_index);
+        lua_setfield(L, -2, "__index");
+        lua_pop(L, 1);
+    }
+    lua_setmetatable(L, -2);
+}
+
+static const char* ListenerThrottleMeta = "_realm_listener_throttle";
+
+// The state of a listener delivering its changes at most once per interval,
+// merging the changes received in between. It is owned by Lua so that a
+// scheduled delivery can outlive the listener. Its user values are the timer
+// function, the delivery function, the callback and the collection changes.
+struct ListenerThrottle {
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point last_delivery;
+    bool is_scheduled;
+    bool is_released;
+    bool has_pending;
+    // Push the pending changes onto the stack and reset them.
+    void (*push_pending)(lua_State* L, ListenerThrottle& throttle, int throttle_index);
+    realm::_impl::CollectionChangeBuilder collection_changes;
+    bool is_deleted;
+    std::vector<realm_property_key_t> modified_properties;
+};
+
+struct realm_lua_object_listener : realm_lua_userdata {
+    int throttle_reference = LUA_NOREF;
+
+    ~realm_lua_object_listener();
+};
+
+struct realm_lua_collection_listener : realm_lua_userdata {
+    int changes_reference;
+    int throttle_reference = LUA_NOREF;
+
+    ~realm_lua_collection_listener();
+};
+
+// Call the callback below the changes of a collection on the stack, with the
+// changes pointed at the given ones for the duration of the call.
+static void call_with_collection_changes(lua_State* L, const realm::CollectionChangeSet& changes) {
+    // Point the changes (top of stack) at the notified ones, invalidating the
+    // index lists of earlier notifications.
+    auto* collection_changes = static_cast<CollectionChanges*>(lua_touserdata(L, -1));
+    collection_changes->changes = &changes;
+    collection_changes->generation++;
+    for (ChangeRanges& ranges : collection_changes->kinds) {
+        ranges.is_loaded = false;
+    }
+
+    // Call the callback function with the changes (top of stack) as the 1 argument.
+    int status = lua_pcall(L, 1, 0, 0);
+    collection_changes->changes = nullptr;
+    if (status != LUA_OK) {
+        _inform_error(L, "Could not call the callback function:\n%1", lua_tostring(L, -1));
+    }
+}
+
+static int throttle_gc(lua_State* L) {
+    auto* throttle = static_cast<ListenerThrottle*>(luaL_checkudata(L, 1, ListenerThrottleMeta));
+    throttle->~ListenerThrottle();
+
+    return 0;
+}
+
+static int deliver_throttled_changes(lua_State* L) {
+    // Get the throttle (upvalue 1) and push it onto the stack.
+    lua_pushvalue(L, lua_upvalueindex(1));
+    int throttle_index = lua_gettop(L);
+    auto* throttle = static_cast<ListenerThrottle*>(lua_touserdata(L, throttle_index));
+    throttle->is_scheduled = false;
+    if (throttle->is_released || !throttle->has_pending) {
+        return 0;
+    }
+    throttle->has_pending = false;
+    throttle->last_delivery = std::chrono::steady_clock::now();
+
+    // Push the callback and the merged changes, and call it.
+    lua_getiuservalue(L, throttle_index, 3);
+    throttle->push_pending(L, *throttle, throttle_index);
+
+    return 0;
+}
+
+static void push_pending_collection_changes(lua_State* L, ListenerThrottle& throttle, int throttle_index) {
+    realm::CollectionChangeSet changes = std::move(throttle.collection_changes).finalize();
+    throttle.collection_changes = {};
+    lua_getiuservalue(L, throttle_index, 4);
+    call_with_collection_changes(L, changes);
+}
+
+static void push_pending_object_changes(lua_State* L, ListenerThrottle& throttle, int throttle_index) {
+    push_object_changes(L, throttle.is_deleted, throttle.modified_properties.data(), throttle.modified_properties.size());
+    throttle.is_deleted = false;
+    throttle.modified_properties.clear();
 
     // Call the callback function with the above table (top of stack) as the 1 argument.
     int status = lua_pcall(L, 1, 0, 0);
     if (status != LUA_OK) {
         _inform_error(L, "Could not call the callback function:\n%1", lua_tostring(L, -1));
+    }
+}
+
+// Check the interval in milliseconds and the timer function at the given
+// indices, if the listener is throttled.
+static void check_throttle(lua_State* L, int interval_index, int timer_index) {
+    if (!lua_isnoneornil(L, interval_index)) {
+        luaL_checkinteger(L, interval_index);
+        luaL_checktype(L, timer_index, LUA_TFUNCTION);
+    }
+}
+
+// Create a throttle from the interval and the timer function at the given
+// (checked) indices and return a reference to it, or LUA_NOREF if there is
+// no interval.
+static int create_throttle(lua_State* L, int interval_index, int timer_index, int callback_index, int changes_index,
+                           void (*push_pending)(lua_State*, ListenerThrottle&, int)) {
+    if (lua_isnoneornil(L, interval_index)) {
+        return LUA_NOREF;
+    }
+    lua_Integer interval = lua_tointeger(L, interval_index);
+
+    auto* throttle = static_cast<ListenerThrottle*>(lua_newuserdatauv(L, sizeof(ListenerThrottle), 4));
+    new (throttle) ListenerThrottle{std::chrono::milliseconds(interval)};
+    throttle->push_pending = push_pending;
+    if (luaL_newmetatable(L, ListenerThrottleMeta)) {
+        lua_pushcfunction(L, throttle_gc);
+        lua_setfield(L, -2, "__gc");
+    }
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, timer_index);
+    lua_setiuservalue(L, -2, 1);
+    lua_pushvalue(L, -1);
+    lua_pushcclosure(L, deliver_throttled_changes, 1);
+    lua_setiuservalue(L, -2, 2);
+    lua_pushvalue(L, callback_index);
+    lua_setiuservalue(L, -2, 3);
+    if (changes_index) {
+        lua_pushvalue(L, changes_index);
+        lua_setiuservalue(L, -2, 4);
+    }
+
+    return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+// Schedule the delivery of the pending changes of the throttle (top of stack)
+// once its interval has passed since the last one, unless already scheduled.
+static void schedule_delivery(lua_State* L, ListenerThrottle& throttle) {
+    throttle.has_pending = true;
+    if (throttle.is_scheduled) {
         return;
     }
+    auto now = std::chrono::steady_clock::now();
+    auto next_delivery = throttle.last_delivery + throttle.interval;
+    auto delay = next_delivery > now ? std::chrono::ceil<std::chrono::milliseconds>(next_delivery - now) : std::chrono::milliseconds(0);
+
+    // Call the timer function with the delay and the delivery function.
+    throttle.is_scheduled = true;
+    lua_getiuservalue(L, -1, 1);
+    lua_pushinteger(L, delay.count());
+    lua_getiuservalue(L, -3, 2);
+    int status = lua_pcall(L, 2, 0, 0);
+    if (status != LUA_OK) {
+        throttle.is_scheduled = false;
+        _inform_error(L, "Could not schedule the delivery of the changes:\n%1", lua_tostring(L, -1));
+    }
 }
 
-static void populate_lua_collection_changes_table(lua_State* L, int table_index, const char* field_name, size_t* changes_indices, size_t changes_indices_size) {
-    // Push an empty table onto the stack acting as a Lua array.
-    lua_newtable(L);
-    for (size_t index = 0; index < changes_indices_size; index++) {
-        // Get the index of the changed object (changes_indices[index])
-        // and convert to Lua's 1-based index (+1) and push onto the stack.
-        lua_pushinteger(L, changes_indices[index] + 1);
-        // Add the above index value to the table/array at position "index + 1"
-        // and pop it from the stack.
-        lua_rawseti(L, -2, index + 1);
+// Mark the throttle as released so that a scheduled delivery does nothing.
+static void release_throttle(lua_State* L, int throttle_reference) {
+    if (throttle_reference == LUA_NOREF) {
+        return;
     }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, throttle_reference);
+    static_cast<ListenerThrottle*>(lua_touserdata(L, -1))->is_released = true;
+    lua_pop(L, 1);
+    luaL_unref(L, LUA_REGISTRYINDEX, throttle_reference);
+}
 
-    // Set the above array (top of the stack) to be the value of
-    // the field_name key on the table and pop from the stack.
-    // (Table: { <field_name>: <changes_indices> })
-    lua_setfield(L, table_index, field_name);
+realm_lua_object_listener::~realm_lua_object_listener() {
+    release_throttle(L, throttle_reference);
 }
 
-static void on_collection_change(realm_lua_userdata* userdata, const realm_collection_changes_t* changes) {
-    size_t num_deletions;
-    size_t num_insertions;
-    size_t num_modifications;
-    realm_collection_changes_get_num_changes(
-        changes,
-        &num_deletions,
-        &num_insertions,
-        &num_modifications,
-        nullptr
-    );
+realm_lua_collection_listener::~realm_lua_collection_listener() {
+    release_throttle(L, throttle_reference);
+    luaL_unref(L, LUA_REGISTRYINDEX, changes_reference);
+}
 
-    size_t deletions_indices[num_deletions];
-    size_t insertions_indices[num_insertions];
-    size_t modifications_indices_old[num_modifications];
-    size_t modifications_indices_new[num_modifications];
-    realm_collection_changes_get_changes(
-        changes,
-        deletions_indices,
-        num_deletions,
-        insertions_indices,
-        num_insertions,
-        modifications_indices_old,
-        num_modifications,
-        modifications_indices_new,
-        num_modifications,
-        nullptr,
-        0
-    );
+static void on_object_change(realm_lua_userdata* userdata, const realm_object_changes_t* changes) {
+    auto* listener = static_cast<realm_lua_object_listener*>(userdata);
+    lua_State* L = listener->L;
 
-    lua_State* L = userdata->L;
+    // Get the modified properties only if the object was not deleted.
+    size_t num_modified_properties = realm_object_changes_get_num_modified_properties(changes);
+    std::vector<realm_property_key_t> modified_properties(num_modified_properties);
+    bool object_is_deleted = realm_object_changes_is_deleted(changes);
+    if (!object_is_deleted) {
+        realm_object_changes_get_modified_properties(changes, modified_properties.data(), num_modified_properties);
+    }
 
-    // Get the Lua callback function from the register and push onto the stack.
-    lua_rawgeti(L, LUA_REGISTRYINDEX, userdata->callback_reference);
+    // Merge the changes into the pending ones of a throttled listener.
+    if (listener->throttle_reference != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, listener->throttle_reference);
+        auto* throttle = static_cast<ListenerThrottle*>(lua_touserdata(L, -1));
+        throttle->is_deleted = throttle->is_deleted || object_is_deleted;
+        for (realm_property_key_t property : modified_properties) {
+            auto& pending = throttle->modified_properties;
+            if (std::find(pending.begin(), pending.end(), property) == pending.end()) {
+                pending.push_back(property);
+            }
+        }
+        schedule_delivery(L, *throttle);
+        lua_pop(L, 1);
+        return;
+    }
 
-    // Push a new table onto the stack and add the indices arrays to the corresponding
-    // keys (e.g. { deletions: <deletions_indices>, insertions: <insertion_indices> }).
-    lua_newtable(L);
-    int table_index = lua_gettop(L);
-    populate_lua_collection_changes_table(L, table_index, "deletions", deletions_indices, num_deletions);
-    populate_lua_collection_changes_table(L, table_index, "insertions", insertions_indices, num_insertions);
-    populate_lua_collection_changes_table(L, table_index, "modificationsOld", modifications_indices_old, num_modifications);
-    populate_lua_collection_changes_table(L, table_index, "modificationsNew", modifications_indices_new, num_modifications);
+    // Get the Lua callback function from the register and put onto the stack.
+    lua_rawgeti(L, LUA_REGISTRYINDEX, listener->callback_reference);
+    push_object_changes(L, object_is_deleted, modified_properties.data(), num_modified_properties);
 
     // Call the callback function with the above table (top of stack) as the 1 argument.
     int status = lua_pcall(L, 1, 0, 0);
@@ -131,30 +481,108 @@ static void on_collection_change(realm_lua_userdata* userdata, const realm_colle
     }
 }
 
+static void on_collection_change(realm_lua_userdata* userdata, const realm_collection_changes_t* changes) {
+    auto* listener = static_cast<realm_lua_collection_listener*>(userdata);
+    lua_State* L = listener->L;
+
+    // Merge the changes into the pending ones of a throttled listener, shifting
+    // the indices of the earlier changes by the later ones.
+    if (listener->throttle_reference != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, listener->throttle_reference);
+        auto* throttle = static_cast<ListenerThrottle*>(lua_touserdata(L, -1));
+        // The builder takes the modifications as indices in the new collection.
+        const realm::CollectionChangeSet& change_set = *changes;
+        throttle->collection_changes.merge(realm::_impl::CollectionChangeBuilder(
+            change_set.deletions,
+            change_set.insertions,
+            change_set.modifications_new,
+            change_set.moves
+        ));
+        schedule_delivery(L, *throttle);
+        lua_pop(L, 1);
+        return;
+    }
+
+    // Get the Lua callback function and the changes of the listener from the
+    // register and push them onto the stack, and call it.
+    lua_rawgeti(L, LUA_REGISTRYINDEX, listener->callback_reference);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, listener->changes_reference);
+    call_with_collection_changes(L, *changes);
+}
+
+// Create the key paths of the class from the array of property names (e.g.
+// "status" or "owner.name") at the given index, or return null to be notified
+// of changes to any property if there is none.
+static realm_key_path_array_t* check_key_paths(lua_State* L, realm_t* realm, realm_class_key_t class_key, int key_paths_index) {
+    if (lua_isnoneornil(L, key_paths_index)) {
+        return nullptr;
+    }
+    luaL_checktype(L, key_paths_index, LUA_TTABLE);
+    size_t num_key_paths = lua_rawlen(L, key_paths_index);
+    if (num_key_paths == 0) {
+        return nullptr;
+    }
+
+    // Check the names first so that no error is raised while the array is
+    // allocated. The strings stay alive while referenced by the table.
+    for (size_t index = 1; index <= num_key_paths; index++) {
+        if (lua_rawgeti(L, key_paths_index, index) != LUA_TSTRING) {
+            _inform_error(L, "Key paths must be strings, got %1", luaL_typename(L, -1));
+        }
+        lua_pop(L, 1);
+    }
+    realm_key_path_array_t* key_path_array;
+    {
+        std::vector<const char*> key_paths(num_key_paths);
+        for (size_t index = 0; index < num_key_paths; index++) {
+            lua_rawgeti(L, key_paths_index, index + 1);
+            key_paths[index] = lua_tostring(L, -1);
+            lua_pop(L, 1);
+        }
+        key_path_array = realm_create_key_path_array(realm, class_key, num_key_paths, key_paths.data());
+    }
+    if (!key_path_array) {
+        _inform_realm_error(L);
+    }
+
+    return key_path_array;
+}
+
 int lib_realm_results_add_listener(lua_State* L) {
-    // Get 1st argument (results/collection) from stack.
-    realm_results_t** results = (realm_results_t**)lua_touserdata(L, 1);
-    
-    // Pop last argument/top of stack (the Lua function) from the stack and save a
-    // reference to it in the register. "callback_reference" is the register location.
-    int callback_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+    // Get arguments (results/collection, realm, class key, key paths, delivery
+    // interval, timer and callback) from stack.
+    realm_results_t** results = check_handle<realm_results_t>(L, 1, "results");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    luaL_checktype(L, 7, LUA_TFUNCTION);
+    lua_settop(L, 7);
+    check_throttle(L, 5, 6);
+    realm_key_path_array_t* key_paths = check_key_paths(L, *realm, class_key, 4);
 
     // Create a pointer to userdata for use in the callback that will be
-    // invoked at a later time.
-    realm_lua_userdata* userdata = new realm_lua_userdata;
+    // invoked at a later time, along with the changes reused by every call.
+    auto* userdata = new realm_lua_collection_listener;
     userdata->L = L;
-    userdata->callback_reference = callback_reference;
+    push_collection_changes(L);
+    userdata->throttle_reference = create_throttle(L, 5, 6, 7, lua_gettop(L), push_pending_collection_changes);
+    userdata->changes_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    // Pop last argument/top of stack (the Lua function) from the stack and save a
+    // reference to it in the register. "callback_reference" is the register location.
+    userdata->callback_reference = luaL_ref(L, LUA_REGISTRYINDEX);
 
     // Get and push the notification token onto the stack and set its metatable.
-    auto** notification_token = static_cast<realm_notification_token_t**>(lua_newuserdata(L, sizeof(realm_notification_token_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    auto** notification_token = push_handle<realm_notification_token_t>(L);
     *notification_token = realm_results_add_notification_callback(
         *results,
         userdata,
         free_lua_userdata,
-        nullptr,
+        key_paths,
         on_collection_change
     );
+    if (key_paths) {
+        realm_release(key_paths);
+    }
 
     if (!*notification_token) {
         lua_pop(L, 1);
@@ -165,30 +593,39 @@ int lib_realm_results_add_listener(lua_State* L) {
 }
 
 int lib_realm_object_add_listener(lua_State* L) {
-    // Get 1st argument (object) from the stack.
-    realm_object_t** object = (realm_object_t**)lua_touserdata(L, 1);
-
-    // Pop last argument/top of stack (the Lua function) from the stack and save a
-    // reference to it in the register. "callback_reference" is the register location.
-    int callback_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+    // Get arguments (object, realm, class key, key paths, delivery interval,
+    // timer and callback) from the stack.
+    realm_object_t** object = check_handle<realm_object_t>(L, 1, "object");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    luaL_checktype(L, 7, LUA_TFUNCTION);
+    lua_settop(L, 7);
+    check_throttle(L, 5, 6);
+    realm_key_path_array_t* key_paths = check_key_paths(L, *realm, class_key, 4);
 
     // Create a pointer to userdata for use in the callback that will be
     // invoked at a later time.
-    realm_lua_userdata* userdata = new realm_lua_userdata;
+    auto* userdata = new realm_lua_object_listener;
     userdata->L = L;
-    userdata->callback_reference = callback_reference;
+    userdata->throttle_reference = create_throttle(L, 5, 6, 7, 0, push_pending_object_changes);
     //userdata->schema = (*object)->get_object_schema();    // TODO: Fix
 
+    // Pop last argument/top of stack (the Lua function) from the stack and save a
+    // reference to it in the register. "callback_reference" is the register location.
+    userdata->callback_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+
     // Push the notification token onto the stack and set its metatable.
-    auto** notification_token = static_cast<realm_notification_token_t**>(lua_newuserdata(L, sizeof(realm_notification_token_t*)));
-    luaL_setmetatable(L, RealmHandle);
+    auto** notification_token = push_handle<realm_notification_token_t>(L);
     *notification_token = realm_object_add_notification_callback(
         *object,
         userdata,
         free_lua_userdata,
-        nullptr,
+        key_paths,
         on_object_change
     );
+    if (key_paths) {
+        realm_release(key_paths);
+    }
 
     if (!*notification_token) {
         lua_pop(L, 1);
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cctype>
+#include <list>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <realm.h>
+
+#include "realm_query.hpp"
+#include "realm_util.hpp"
+
+static const char* QueryCacheMeta = "_realm_query_cache";
+
+// The number of parsed queries kept per realm if not specified.
+static const size_t DefaultQueryCacheCapacity = 64;
+
+// Get the number of arguments a query string refers to ($0, $1, ...),
+// skipping string literals.
+static size_t count_query_arguments(std::string_view query_string) {
+    size_t num_args = 0;
+    char quote = 0;
+    for (size_t index = 0; index < query_string.size(); index++) {
+        char c = query_string[index];
+        if (quote) {
+            if (c == '\\') {
+                index++;
+            }
+            else if (c == quote) {
+                quote = 0;
+            }
+        }
+        else if (c == '"' || c == '\'') {
+            quote = c;
+        }
+        else if (c == '$') {
+            size_t arg = 0;
+            size_t end = index + 1;
+            while (end < query_string.size() && isdigit(static_cast<unsigned char>(query_string[end]))) {
+                arg = arg * 10 + (query_string[end] - '0');
+                end++;
+            }
+            if (end > index + 1) {
+                num_args = std::max(num_args, arg + 1);
+            }
+            index = end - 1;
+        }
+    }
+
+    return num_args;
+}
+
+// A least recently used cache of the parsed queries of a realm, by class key
+// and query string. Realm Core binds the arguments of a query when parsing
+// it, so only the queries without arguments are kept, while the others are
+// parsed with their arguments on every run.
+class QueryCache {
+public:
+    explicit QueryCache(size_t capacity)
+    : m_capacity(capacity)
+    { }
+
+    ~QueryCache() {
+        clear();
+    }
+
+    // Get the query for the class, query string and the arguments on the stack
+    // from the cache, or parse it. A query with arguments is not cached and must
+    // be released by the caller. The query string must be null-terminated.
+    realm_query_t* get_or_parse(lua_State* L, realm_t* realm, realm_class_key_t class_key, std::string_view query_string, int num_args, int lua_arg_offset) {
+        if (num_args > 0) {
+            // Convert the arguments in the reused buffers.
+            m_values.resize(num_args);
+            for (int index = 0; index < num_args; index++) {
+                m_values[index] = *lua_to_realm_value(L, lua_arg_offset + index);
+            }
+            return parse(realm, class_key, query_string.data());
+        }
+
+        m_key.clear();
+        m_key.append(reinterpret_cast<const char*>(&class_key), sizeof(class_key));
+        m_key.append(query_string);
+        auto it = m_index.find(m_key);
+        if (it != m_index.end()) {
+            // Move the entry to the front as the most recently used.
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->second;
+        }
+
+        m_values.clear();
+        realm_query_t* query = parse(realm, class_key, query_string.data());
+        if (!query) {
+            return nullptr;
+        }
+        m_entries.emplace_front(m_key, query);
+        m_index.emplace(m_entries.front().first, m_entries.begin());
+
+        // Evict the least recently used entry.
+        if (m_entries.size() > m_capacity) {
+            Entry& last = m_entries.back();
+            m_index.erase(last.first);
+            realm_release(last.second);
+            m_entries.pop_back();
+        }
+
+        return query;
+    }
+
+    // Parse the query string to report its errors before it runs. The values
+    // of its arguments are not known yet, so they are checked as null.
+    bool check(lua_State* L, realm_t* realm, realm_class_key_t class_key, std::string_view query_string) {
+        size_t num_args = count_query_arguments(query_string);
+        if (num_args == 0) {
+            return get_or_parse(L, realm, class_key, query_string, 0, 0) != nullptr;
+        }
+
+        realm_value_t null_value{};
+        null_value.type = RLM_TYPE_NULL;
+        m_values.assign(num_args, null_value);
+        realm_query_t* query = parse(realm, class_key, query_string.data());
+        if (!query) {
+            return false;
+        }
+        realm_release(query);
+
+        return true;
+    }
+
+    void clear() {
+        for (Entry& entry : m_entries) {
+            realm_release(entry.second);
+        }
+        m_index.clear();
+        m_entries.clear();
+    }
+
+private:
+    using Entry = std::pair<std::string, realm_query_t*>;
+
+    // Parse the query string with the arguments in the buffer.
+    realm_query_t* parse(realm_t* realm, realm_class_key_t class_key, const char* query_string) {
+        m_args.resize(m_values.size());
+        for (size_t index = 0; index < m_values.size(); index++) {
+            m_args[index] = realm_query_arg_t {
+                .nb_args = 1,
+                .is_list = false,
+                .arg = &m_values[index],
+            };
+        }
+
+        return realm_query_parse(realm, class_key, query_string, m_args.size(), m_args.data());
+    }
+
+    size_t m_capacity;
+
+    // The entries ordered from most to least recently used, and indexed by
+    // their key (which points into the entry).
+    std::list<Entry> m_entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;
+
+    // Buffers reused between lookups.
+    std::string m_key;
+    std::vector<realm_value_t> m_values;
+    std::vector<realm_query_arg_t> m_args;
+};
+
+static int query_cache_gc(lua_State* L) {
+    auto* cache = static_cast<QueryCache*>(luaL_checkudata(L, 1, QueryCacheMeta));
+    cache->~QueryCache();
+
+    return 0;
+}
+
+int lib_realm_query_cache_new(lua_State* L) {
+    // Get the optional argument from the stack.
+    size_t capacity = luaL_optinteger(L, 1, DefaultQueryCacheCapacity);
+
+    // Create and push the cache onto the stack and set its metatable.
+    auto* cache = static_cast<QueryCache*>(lua_newuserdata(L, sizeof(QueryCache)));
+    new (cache) QueryCache(capacity);
+    if (luaL_newmetatable(L, QueryCacheMeta)) {
+        lua_pushcfunction(L, query_cache_gc);
+        lua_setfield(L, -2, "__gc");
+    }
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+int lib_realm_query_cache_clear(lua_State* L) {
+    auto* cache = static_cast<QueryCache*>(luaL_checkudata(L, 1, QueryCacheMeta));
+    cache->clear();
+
+    return 0;
+}
+
+int lib_realm_results_filter(lua_State* L) {
+    // Get the arguments from the stack.
+    realm_results_t** unfiltered_result = check_handle<realm_results_t>(L, 1, "results");
+    realm_t** realm = check_handle<realm_t>(L, 2, "realm");
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    std::string_view query_string = lua_tostringview(L, 4);
+    auto* cache = static_cast<QueryCache*>(luaL_checkudata(L, 5, QueryCacheMeta));
+    int num_args = lua_tointeger(L, 6);
+
+    // Get the parsed query string.
+    size_t lua_arg_offset = 7;
+    realm_results_t** result = push_handle<realm_results_t>(L);
+    realm_query_t* query = cache->get_or_parse(L, *realm, class_key, query_string, num_args, lua_arg_offset);
+    if (!query) {
+        return _inform_realm_error(L);
+    }
+
+    // Get the filtered result into the handle pushed onto the stack.
+    *result = realm_results_filter(*unfiltered_result, query);
+    if (num_args > 0) {
+        realm_release(query);
+    }
+    if (!*result) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_query_find_all(lua_State* L) {
+    // Get the arguments from the stack.
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    auto* cache = static_cast<QueryCache*>(luaL_checkudata(L, 2, QueryCacheMeta));
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    std::string_view query_string = lua_tostringview(L, 4);
+    int num_args = lua_tointeger(L, 5);
+
+    // Get the parsed query string.
+    size_t lua_arg_offset = 6;
+    realm_results_t** results = push_handle<realm_results_t>(L);
+    realm_query_t* query = cache->get_or_parse(L, *realm, class_key, query_string, num_args, lua_arg_offset);
+    if (!query) {
+        return _inform_realm_error(L);
+    }
+
+    // Get the results into the handle pushed onto the stack.
+    *results = realm_query_find_all(query);
+    if (num_args > 0) {
+        realm_release(query);
+    }
+    if (!*results) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_query_prepare(lua_State* L) {
+    // Get the arguments from the stack.
+    realm_t** realm = check_handle<realm_t>(L, 1, "realm");
+    auto* cache = static_cast<QueryCache*>(luaL_checkudata(L, 2, QueryCacheMeta));
+    const realm_class_key_t class_key = lua_tointeger(L, 3);
+    std::string_view query_string = lua_tostringview(L, 4);
+
+    if (!cache->check(L, *realm, class_key, query_string)) {
+        return _inform_realm_error(L);
+    }
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+#include <lua.hpp>
+
+int lib_realm_results_filter(lua_State* L);
+
+int lib_realm_query_find_all(lua_State* L);
+
+int lib_realm_query_prepare(lua_State* L);
+
+int lib_realm_query_cache_new(lua_State* L);
+
+int lib_realm_query_cache_clear(lua_State* L);
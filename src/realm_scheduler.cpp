@@ -1,67 +1,34 @@
-#include <thread>
+#include <memory>
 #include <realm.h>
 
 #include "realm_scheduler.hpp"
 #include "realm_util.hpp"
+#include "realm_work_queue.hpp"
 
-#include <realm/object-store/util/scheduler.hpp>
 #include <realm/object-store/c_api/types.hpp>
 
 namespace luv {
 
-static const char* UserdataMeta = "realm_scheduler_luv_userdata";
+static const char* QueueMeta = "realm_scheduler_luv_queue";
 
 typedef struct uv_async_s uv_async_t;
 typedef int(*uv_async_send_t)(uv_async_t*);
 
-class Scheduler : public realm::util::Scheduler {
+// The work queue of a loop, woken up by a single async handle.
+class AsyncWorkQueue : public WorkQueue {
 public:
-    struct Userdata {
-        realm::util::InvocationQueue queue;
-
-        volatile bool close_requested;
-        bool closed = false;
-
-        ~Userdata() {
-            closed = true;
-        }
-    };
-
-    Scheduler(uv_async_t* async, uv_async_send_t send, Userdata* userdata)
+    AsyncWorkQueue(uv_async_t* async, uv_async_send_t send)
     : m_async(async)
     , m_send(send)
-    , m_userdata(userdata)
     { }
 
-    ~Scheduler() {
-        m_userdata->close_requested = true;
+    virtual void wake() final {
         m_send(m_async);
     }
 
-    virtual void invoke(realm::util::UniqueFunction<void()>&& fn) final {
-        m_userdata->queue.push(std::move(fn));
-        m_send(m_async);
-    };
-
-    virtual bool is_on_thread() const noexcept final {
-        return m_thread == std::this_thread::get_id();
-    }
-
-    virtual bool is_same_as(const realm::util::Scheduler* other) const noexcept final {
-        if (auto other_scheduler = dynamic_cast<const Scheduler*>(other)) {
-            return m_async == other_scheduler->m_async;
-        }
-        return false;
-    }
-
-    virtual bool can_invoke() const noexcept final { return true; }
 private:
-    std::thread::id m_thread = std::this_thread::get_id();
-
     uv_async_t* m_async;
     uv_async_send_t m_send;
-
-    Userdata* m_userdata;
 };
 
 #if defined(_WIN32)
@@ -76,32 +43,23 @@ static void* find_function(void* lib, const char* name) {
 }
 #endif
 
-static int create_scheduler(lua_State* L) {
-    uv_async_t* async = *static_cast<uv_async_t**>(luaL_checkudata(L, 1, "uv_async"));
-    //int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+// The uv_async_send function of the luv module, resolved once.
+static uv_async_send_t resolved_uv_async_send = nullptr;
 
+static int find_uv_async_send(lua_State* L) {
     lua_getfield(L, LUA_REGISTRYINDEX, "_CLIBS");
     lua_pushnil(L);
     while (lua_next(L, -2)) {
         if (lua_type(L, -2) == LUA_TSTRING && ends_with(lua_tostringview(L, -2), "luv.so")) {
             void* lib = lua_touserdata(L, -1);
-            // Pop the key off the stack, we'll be returning early.
-            lua_pop(L, 1);
+            // Pop the key, value and _CLIBS off the stack, we'll be returning early.
+            lua_pop(L, 3);
 
-            auto uv_async_send = reinterpret_cast<int(*)(uv_async_t*)>(find_function(lib, "uv_async_send"));
-            if (!uv_async_send) {
+            resolved_uv_async_send = reinterpret_cast<uv_async_send_t>(find_function(lib, "uv_async_send"));
+            if (!resolved_uv_async_send) {
                 return _inform_error(L, "Could not find the libuv symbols in the luv module.");
             }
-
-            auto userdata = static_cast<Scheduler::Userdata*>(lua_newuserdata(L, sizeof(Scheduler::Userdata)));
-            new (userdata) Scheduler::Userdata;
-            luaL_setmetatable(L, UserdataMeta);
-
-            auto scheduler = static_cast<realm_scheduler_t**>(lua_newuserdata(L, sizeof(realm_scheduler_t*)));
-            *scheduler = new realm_scheduler_t(std::make_shared<Scheduler>(async, uv_async_send, userdata));
-            luaL_setmetatable(L, RealmHandle);
-            
-            return 2;
+            return 0;
         }
         // Pop the last key off the stack.
         lua_pop(L, 1);
@@ -110,49 +68,69 @@ static int create_scheduler(lua_State* L) {
     return _inform_error(L, "Could not find the luv native module.");
 }
 
+static int create_queue(lua_State* L) {
+    uv_async_t* async = *static_cast<uv_async_t**>(luaL_checkudata(L, 1, "uv_async"));
+    if (!resolved_uv_async_send) {
+        find_uv_async_send(L);
+    }
+
+    auto queue = static_cast<std::shared_ptr<WorkQueue>*>(lua_newuserdatauv(L, sizeof(std::shared_ptr<WorkQueue>), 0));
+    new (queue) std::shared_ptr<WorkQueue>(std::make_shared<AsyncWorkQueue>(async, resolved_uv_async_send));
+    luaL_setmetatable(L, QueueMeta);
+
+    return 1;
+}
+
+static int create_scheduler(lua_State* L) {
+    auto queue = static_cast<std::shared_ptr<WorkQueue>*>(luaL_checkudata(L, 1, QueueMeta));
+    WorkQueue::Lane lane = WorkQueue::check_lane(L, 2);
+
+    auto scheduler = push_handle<realm_scheduler_t>(L);
+    *scheduler = new realm_scheduler_t(std::make_shared<QueueScheduler>(*queue, lane));
+
+    return 1;
+}
+
 static int should_close(lua_State* L) {
-    auto userdata = static_cast<Scheduler::Userdata*>(luaL_checkudata(L, 1, UserdataMeta));
-    lua_pushboolean(L, userdata->close_requested);
+    auto queue = static_cast<std::shared_ptr<WorkQueue>*>(luaL_checkudata(L, 1, QueueMeta));
+    lua_pushboolean(L, !(*queue)->has_schedulers());
 
     return 1;
 }
 
-static int close(lua_State* L) {
-    auto userdata = static_cast<Scheduler::Userdata*>(luaL_checkudata(L, 1, UserdataMeta));
-    if (!userdata->closed) {
-        userdata->~Userdata();
-    }
+static int queue_gc(lua_State* L) {
+    auto queue = static_cast<std::shared_ptr<WorkQueue>*>(luaL_checkudata(L, 1, QueueMeta));
+    queue->~shared_ptr();
 
     return 0;
 }
 
 static int do_work(lua_State* L) {
-    auto userdata = static_cast<Scheduler::Userdata*>(luaL_checkudata(L, 1, UserdataMeta));
-    userdata->queue.invoke_all();
+    auto queue = static_cast<std::shared_ptr<WorkQueue>*>(luaL_checkudata(L, 1, QueueMeta));
 
-    return 0;
+    return (*queue)->invoke(L, 2);
 }
 
 extern "C" int luaopen_realm_scheduler_libuv_native(lua_State* L) {
-    luaL_Reg userdata_meta[] = {
-        {"__gc", close},
+    luaL_Reg queue_meta[] = {
+        {"__gc", queue_gc},
         {NULL, NULL}
     };
-    luaL_newmetatable(L, UserdataMeta);
-    luaL_setfuncs(L, userdata_meta, 0);
+    luaL_newmetatable(L, QueueMeta);
+    luaL_setfuncs(L, queue_meta, 0);
 
-    luaL_Reg userdata_funcs[] {
+    luaL_Reg queue_funcs[] {
         {"should_close", should_close},
-        {"close", close},
         {"do_work", do_work},
         {NULL, NULL}
     };
-    luaL_newlib(L, userdata_funcs);
+    luaL_newlib(L, queue_funcs);
     lua_setfield(L, -2, "__index");
-    
-    lua_pop(L, 1); // pop the userdata metatable
+
+    lua_pop(L, 1); // pop the queue metatable
 
     luaL_Reg funcs[] = {
+        {"create_queue", create_queue},
         {"create_scheduler", create_scheduler},
         {NULL, NULL}
     };
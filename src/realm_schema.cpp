@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <lua.hpp>
@@ -5,6 +6,7 @@
 #include <realm/object-store/c_api/types.hpp>
 #include <realm/object-store/c_api/conversion.hpp>
 
+#include "realm_accessors.hpp"
 #include "realm_util.hpp"
 #include "realm_schema.hpp"
 
@@ -150,10 +152,13 @@ realm_schema_t* _parse_schema(lua_State* L) {
     return realm_schema_new(classes, classes_len, properties);
 }
 
-void _push_schema_info(lua_State* L, const realm_t* realm) {
+void _push_schema_info(lua_State* L, const realm_t* realm, int object_table) {
+    object_table = lua_absindex(L, object_table);
     const realm::Schema& schema = (*realm)->schema();
     
-    lua_newtable(L);
+    // The class infos by name and by key.
+    lua_createtable(L, 0, schema.size());
+    lua_createtable(L, 0, schema.size());
 
     const char* class_name;
     const char* property_name;
@@ -213,9 +218,33 @@ void _push_schema_info(lua_State* L, const realm_t* realm) {
             lua_setfield(L, -2, property_name);
         }
         lua_setfield(L, -2, "properties");
+
+        // Cache the keys and names of the properties holding single values, which
+        // are read at once when converting objects to tables.
+        std::vector<realm_property_key_t> value_keys;
+        lua_newtable(L);
+        for (const realm::Property& property_info : class_info.persisted_properties) {
+            if (!bool(property_info.type & realm::PropertyType::Collection)) {
+                value_keys.push_back(property_info.column_key.value);
+                lua_pushstring(L, property_info.name.c_str());
+                lua_rawseti(L, -2, value_keys.size());
+            }
+        }
+        lua_setfield(L, -2, "valueNames");
+        size_t keys_size = value_keys.size() * sizeof(realm_property_key_t);
+        void* keys_userdata = lua_newuserdata(L, keys_size);
+        if (keys_size > 0) {
+            memcpy(keys_userdata, value_keys.data(), keys_size);
+        }
+        lua_setfield(L, -2, "valueKeys");
+
+        _push_class_metatable(L, class_info, object_table);
+        lua_setfield(L, -2, "metatable");
         
-        // Set the field on the greater schema info table
-        // for easy lookup by class name.
-        lua_setfield(L, -2, class_name);
+        // Set the field on the greater schema info tables
+        // for easy lookup by class key and by class name.
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, class_info.table_key.value);
+        lua_setfield(L, -3, class_name);
     }
 }
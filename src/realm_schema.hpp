@@ -8,4 +8,7 @@ realm_schema_t* _parse_schema(lua_State*);
 // an already open Realm. Useful for caching purposes. 
 // The Lua object is in form: 
 // [class_name] => { key, property: ([property_name] => property_info) }
-void _push_schema_info(lua_State*, const realm_t*);
+// A second map of class key to the same class info is pushed after it.
+// Every class info also gets the metatable of its objects, falling back
+// to the RealmObject table at object_table.
+void _push_schema_info(lua_State*, const realm_t*, int object_table);
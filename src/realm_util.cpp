@@ -1,3 +1,4 @@
+#include "realm_accessors.hpp"
 #include "realm_util.hpp"
 
 int _inform_realm_error(lua_State* L) {
@@ -7,6 +8,53 @@ int _inform_realm_error(lua_State* L) {
     return _inform_error(L, error.message);
 }
 
+realm_lua_handle* push_handle_node(lua_State* L, size_t size) {
+    auto* handle = static_cast<realm_lua_handle*>(lua_newuserdata(L, size));
+    handle->value = nullptr;
+    handle->prev = handle;
+    handle->next = handle;
+    handle->release = nullptr;
+    luaL_setmetatable(L, RealmHandle);
+
+    return handle;
+}
+
+static void unlink_handle(realm_lua_handle* handle) {
+    handle->prev->next = handle->next;
+    handle->next->prev = handle->prev;
+    handle->prev = handle;
+    handle->next = handle;
+}
+
+void link_handle(realm_lua_handle* head, realm_lua_handle* handle) {
+    unlink_handle(handle);
+    handle->prev = head;
+    handle->next = head->next;
+    head->next->prev = handle;
+    head->next = handle;
+}
+
+void release_handle(realm_lua_handle* handle) {
+    unlink_handle(handle);
+    if (!handle->value) {
+        return;
+    }
+    if (handle->release) {
+        handle->release(handle->value);
+    }
+    else {
+        realm_release(handle->value);
+    }
+    handle->value = nullptr;
+}
+
+void release_handles(realm_lua_handle* head, realm_lua_handle* end) {
+    // Releasing a handle unlinks it, so the next one takes its place.
+    while (head->next != end && head->next != head) {
+        release_handle(head->next);
+    }
+}
+
 std::optional<realm_value_t> lua_to_realm_value(lua_State* L, int arg_index) {
     // TODO: Add support for lists as input.
     if (lua_type(L, arg_index) == LUA_TNUMBER) {
@@ -36,10 +84,12 @@ std::optional<realm_value_t> lua_to_realm_value(lua_State* L, int arg_index) {
         };
     }
     if (lua_type(L, arg_index) == LUA_TUSERDATA) {
-        // All userdata is meant to be a reference to a valid Realm Object.
-        luaL_checkudata(L, arg_index, RealmHandle);
+        // All userdata is meant to be a reference to a valid Realm Object,
+        // either an object handle or an object proxy.
+        if (!luaL_testudata(L, arg_index, RealmHandle) && !_is_object_proxy(L, arg_index)) {
+            luaL_typeerror(L, arg_index, "Realm object");
+        }
         realm_object_t** realm_object = (realm_object_t**)lua_touserdata(L, arg_index);
-        luaL_setmetatable(L, RealmHandle);
         return realm_value_t {
             .type = RLM_TYPE_LINK,
             .link = realm_object_as_link(*realm_object)
@@ -63,7 +113,10 @@ int realm_to_lua_value(lua_State* L, realm_t* realm, realm_value_t value) {
             lua_pushboolean(L, value.boolean);
             return 1;
         case RLM_TYPE_STRING:
-            lua_pushstring(L, value.string.data);
+            lua_pushlstring(L, value.string.data, value.string.size);
+            return 1;
+        case RLM_TYPE_BINARY:
+            lua_pushlstring(L, reinterpret_cast<const char*>(value.binary.data), value.binary.size);
             return 1;
         case RLM_TYPE_FLOAT:
             lua_pushnumber(L, value.fnum);
@@ -73,8 +126,7 @@ int realm_to_lua_value(lua_State* L, realm_t* realm, realm_value_t value) {
             return 1;
         case RLM_TYPE_LINK: {
             // Get and push the object onto the stack and set its metatable.
-            realm_object_t** object = static_cast<realm_object_t**>(lua_newuserdata(L, sizeof(realm_object_t*)));
-            luaL_setmetatable(L, RealmHandle);
+            realm_object_t** object = push_handle<realm_object_t>(L);
             *object = realm_get_object(realm, value.link.target_table, value.link.target);
             lua_pushinteger(L, value.link.target_table);
             return 2;
@@ -113,6 +165,22 @@ std::optional<realm_property_info_t> get_property_info_by_key(lua_State* L, real
     return property_info;
 }
 
+bool get_class_properties(realm_t* realm, realm_class_key_t class_key, std::vector<realm_property_info_t>& properties) {
+    realm_class_info_t class_info;
+    if (!realm_get_class(realm, class_key, &class_info)) {
+        return false;
+    }
+
+    size_t num_properties;
+    properties.resize(class_info.num_properties + class_info.num_computed_properties);
+    if (!realm_get_class_properties(realm, class_key, properties.data(), properties.size(), &num_properties)) {
+        return false;
+    }
+    properties.resize(num_properties);
+
+    return true;
+}
+
 realm_lua_userdata::~realm_lua_userdata() = default;
 
 void free_lua_userdata(realm_lua_userdata* userdata) {
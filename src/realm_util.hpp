@@ -2,6 +2,7 @@
 #define REALM_LUA_UTIL_H
 #include <lua.hpp>
 #include <string_view>
+#include <vector>
 
 #include <realm.h>
 #include <realm/util/to_string.hpp>
@@ -40,6 +41,9 @@ std::optional<realm_property_info_t> get_property_info_by_name(lua_State* L, rea
 // Fetch property info based on an object and its property key.
 std::optional<realm_property_info_t> get_property_info_by_key(lua_State* L, realm_t* realm, realm_object_t* object, realm_property_key_t property_key);
 
+// Fetch the info of all properties of a class.
+bool get_class_properties(realm_t* realm, realm_class_key_t class_key, std::vector<realm_property_info_t>& properties);
+
 // Check whether a given string ends with a specific set of characters.
 inline bool ends_with (const std::string_view& full_string, const std::string_view& ending) {
     if (full_string.length() >= ending.length()) {
@@ -59,6 +63,48 @@ inline std::string_view lua_tostringview(lua_State* L, int index) {
     return {};
 }
 
+// The userdata of every handle. The value comes first so that natives can
+// read any handle as a pointer to its value. Handles tracked by a realm are
+// linked in a ring headed by the handle of the realm, so that they can be
+// unlinked when collected and released together when it is closed.
+struct realm_lua_handle {
+    void* value;
+    realm_lua_handle* prev;
+    realm_lua_handle* next;
+    // Release the value in place, or null to release it with realm_release.
+    void (*release)(void* value);
+};
+
+// Create and push a handle of the given size onto the stack and set its metatable.
+realm_lua_handle* push_handle_node(lua_State* L, size_t size = sizeof(realm_lua_handle));
+
+// Create and push a handle onto the stack and set its metatable.
+template <typename T>
+T** push_handle(lua_State* L) {
+    return reinterpret_cast<T**>(&push_handle_node(L)->value);
+}
+
+// Get the handle or object proxy at the given index, raising an error if its
+// value has been released, e.g. at the end of a scope.
+template <typename T>
+T** check_handle(lua_State* L, int index, const char* name) {
+    auto** handle = static_cast<T**>(lua_touserdata(L, index));
+    if (!handle || !*handle) {
+        _inform_error(L, "Invalid %1", name);
+    }
+
+    return handle;
+}
+
+// Link a handle into the ring of a realm handle, after the head.
+void link_handle(realm_lua_handle* head, realm_lua_handle* handle);
+
+// Unlink a handle and release its value.
+void release_handle(realm_lua_handle* handle);
+
+// Release the handles linked after the head, up to the end (or all of them).
+void release_handles(realm_lua_handle* head, realm_lua_handle* end);
+
 struct realm_lua_userdata {
     lua_State* L;
     int callback_reference;
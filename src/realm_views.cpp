@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+#include <realm/object-store/c_api/types.hpp>
+#include <realm/object-store/shared_realm.hpp>
+
+#include "realm_util.hpp"
+#include "realm_views.hpp"
+
+static const char* ViewMeta = "_realm_view";
+
+// A view of a string or binary value pointing into the memory mapped by the
+// realm. The memory is only guaranteed to hold the value at the read version
+// the view was created at, and not while a write transaction may modify it.
+struct RealmView {
+    std::shared_ptr<realm::Realm> realm;
+    realm::VersionID version;
+    std::string_view bytes;
+};
+
+static bool is_valid(const RealmView& view) {
+    const realm::Realm& realm = *view.realm;
+
+    return !realm.is_closed()
+        && realm.is_in_read_transaction()
+        && !realm.is_in_transaction()
+        && realm.read_transaction_version() == view.version;
+}
+
+// Get the bytes of the view at the given index, or raise an error if it is no longer valid.
+static std::string_view check_view(lua_State* L, int index) {
+    auto* view = static_cast<RealmView*>(luaL_checkudata(L, index, ViewMeta));
+    if (!is_valid(*view)) {
+        _inform_error(L, "The view is no longer valid, the realm has changed since it was created");
+    }
+
+    return view->bytes;
+}
+
+// Get the bytes of a view or a string at the given index.
+static std::string_view check_bytes(lua_State* L, int index) {
+    if (luaL_testudata(L, index, ViewMeta)) {
+        return check_view(L, index);
+    }
+    size_t size;
+    const char* data = luaL_checklstring(L, index, &size);
+
+    return std::string_view(data, size);
+}
+
+static int view_gc(lua_State* L) {
+    auto* view = static_cast<RealmView*>(luaL_checkudata(L, 1, ViewMeta));
+    view->~RealmView();
+
+    return 0;
+}
+
+static int view_len(lua_State* L) {
+    lua_pushinteger(L, check_view(L, 1).size());
+
+    return 1;
+}
+
+static int view_tostring(lua_State* L) {
+    std::string_view bytes = check_view(L, 1);
+    lua_pushlstring(L, bytes.data(), bytes.size());
+
+    return 1;
+}
+
+static int view_equals(lua_State* L) {
+    lua_pushboolean(L, check_bytes(L, 1) == check_bytes(L, 2));
+
+    return 1;
+}
+
+static int view_lt(lua_State* L) {
+    lua_pushboolean(L, check_bytes(L, 1) < check_bytes(L, 2));
+
+    return 1;
+}
+
+static int view_le(lua_State* L) {
+    lua_pushboolean(L, check_bytes(L, 1) <= check_bytes(L, 2));
+
+    return 1;
+}
+
+static int view_sub(lua_State* L) {
+    // Resolve the positions like string.sub.
+    std::string_view bytes = check_view(L, 1);
+    lua_Integer size = bytes.size();
+    lua_Integer start = luaL_optinteger(L, 2, 1);
+    lua_Integer end = luaL_optinteger(L, 3, -1);
+    if (start < 0) {
+        start = std::max<lua_Integer>(size + start + 1, 1);
+    }
+    else if (start == 0) {
+        start = 1;
+    }
+    if (end < 0) {
+        end = size + end + 1;
+    }
+    else if (end > size) {
+        end = size;
+    }
+
+    // Copy only the requested bytes into a Lua string.
+    if (start > end) {
+        lua_pushliteral(L, "");
+    }
+    else {
+        lua_pushlstring(L, bytes.data() + start - 1, end - start + 1);
+    }
+
+    return 1;
+}
+
+static int view_is_valid(lua_State* L) {
+    auto* view = static_cast<RealmView*>(luaL_checkudata(L, 1, ViewMeta));
+    lua_pushboolean(L, is_valid(*view));
+
+    return 1;
+}
+
+static void push_view_metatable(lua_State* L) {
+    if (!luaL_newmetatable(L, ViewMeta)) {
+        return;
+    }
+    const luaL_Reg metamethods[] = {
+        {"__gc",        view_gc},
+        {"__len",       view_len},
+        {"__eq",        view_equals},
+        {"__lt",        view_lt},
+        {"__le",        view_le},
+        {"__tostring",  view_tostring},
+        {NULL, NULL}
+    };
+    luaL_setfuncs(L, metamethods, 0);
+
+    const luaL_Reg methods[] = {
+        {"sub",         view_sub},
+        {"equals",      view_equals},
+        {"tostring",    view_tostring},
+        {"isValid",     view_is_valid},
+        {NULL, NULL}
+    };
+    luaL_newlib(L, methods);
+    lua_setfield(L, -2, "__index");
+}
+
+int lib_realm_object_get_view(lua_State* L) {
+    // Get arguments from the stack.
+    realm_object_t* object = *check_handle<realm_object_t>(L, 1, "object");
+    realm_property_key_t& property_key = *(static_cast<realm_property_key_t*>(lua_touserdata(L, 2)));
+
+    try {
+        const std::shared_ptr<realm::Realm>& realm = object->get_realm();
+        if (realm->is_in_transaction()) {
+            throw std::logic_error("Cannot create a view within a write transaction");
+        }
+        object->verify_attached();
+
+        // Point into the value of the string or binary property.
+        realm::ColKey column(property_key);
+        std::string_view bytes;
+        bool is_null;
+        if (column.is_collection()) {
+            throw std::invalid_argument("Cannot create a view of a collection");
+        }
+        else if (column.get_type() == realm::col_type_String) {
+            realm::StringData value = object->obj().get<realm::StringData>(column);
+            is_null = value.is_null();
+            bytes = std::string_view(value.data(), value.size());
+        }
+        else if (column.get_type() == realm::col_type_Binary) {
+            realm::BinaryData value = object->obj().get<realm::BinaryData>(column);
+            is_null = value.is_null();
+            bytes = std::string_view(value.data(), value.size());
+        }
+        else {
+            throw std::invalid_argument("Views can only be created of string and binary properties");
+        }
+        if (is_null) {
+            lua_pushnil(L);
+            return 1;
+        }
+
+        // Create and push the view onto the stack and set its metatable.
+        auto* view = static_cast<RealmView*>(lua_newuserdatauv(L, sizeof(RealmView), 0));
+        new (view) RealmView{realm, realm->read_transaction_version(), bytes};
+        push_view_metatable(L);
+        lua_setmetatable(L, -2);
+
+        return 1;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
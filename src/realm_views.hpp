@@ -0,0 +1,3 @@
+#include <lua.hpp>
+
+int lib_realm_object_get_view(lua_State* L);
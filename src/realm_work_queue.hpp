@@ -0,0 +1,157 @@
+#ifndef REALM_LUA_WORK_QUEUE_H
+#define REALM_LUA_WORK_QUEUE_H
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <lua.hpp>
+
+#include <realm/object-store/util/scheduler.hpp>
+
+// The work of every scheduler of an event loop, in one lane per priority.
+// Subclasses wake up the loop so that it invokes the work on its thread.
+class WorkQueue {
+public:
+    enum Lane {
+        Interactive,
+        Background,
+        NumLanes
+    };
+
+    virtual ~WorkQueue() = default;
+
+    // Wake up the loop, from any thread.
+    virtual void wake() = 0;
+
+    void push(Lane lane, const void* owner, realm::util::UniqueFunction<void()>&& fn) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_lanes[lane].push_back({owner, std::move(fn)});
+        }
+        wake();
+    }
+
+    // Invoke the queued work, interactive work first, until the budget is
+    // spent (or all of it without one). Returns whether work remains.
+    bool invoke(std::chrono::microseconds budget) {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        do {
+            realm::util::UniqueFunction<void()> fn;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto lane = std::find_if(std::begin(m_lanes), std::end(m_lanes), [](auto& work) { return !work.empty(); });
+                if (lane == std::end(m_lanes)) {
+                    return false;
+                }
+                fn = std::move(lane->front().fn);
+                lane->pop_front();
+            }
+            fn();
+        } while (budget.count() <= 0 || std::chrono::steady_clock::now() < deadline);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::any_of(std::begin(m_lanes), std::end(m_lanes), [](auto& work) { return !work.empty(); });
+    }
+
+    // Invoke the queued work for up to the budget in milliseconds at the given
+    // index (or all of it without one) and push whether work remains.
+    int invoke(lua_State* L, int budget_index) {
+        auto budget = std::chrono::duration<lua_Number, std::milli>(luaL_optnumber(L, budget_index, 0));
+        lua_pushboolean(L, invoke(std::chrono::duration_cast<std::chrono::microseconds>(budget)));
+
+        return 1;
+    }
+
+    // Drop the work of a scheduler being destroyed.
+    void discard(const void* owner) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& lane : m_lanes) {
+            lane.erase(std::remove_if(lane.begin(), lane.end(), [&](auto& work) { return work.owner == owner; }), lane.end());
+        }
+    }
+
+    // Get the lane of the priority ("interactive" or "background") at the given index.
+    static Lane check_lane(lua_State* L, int index) {
+        const char* lanes[] = {"interactive", "background", NULL};
+
+        return static_cast<Lane>(luaL_checkoption(L, index, "interactive", lanes));
+    }
+
+    void add_scheduler() {
+        std::lock_guard<std::mutex> lock(m_schedulers_mutex);
+        m_schedulers++;
+    }
+
+    // Let go of a scheduler, which may happen on any thread, and wake up the
+    // loop to let go of the queue if this was the last one. The loop checks
+    // for schedulers under the same lock, so it cannot close what wakes it up
+    // while the last wake is still being sent.
+    void remove_scheduler() {
+        std::lock_guard<std::mutex> lock(m_schedulers_mutex);
+        if (--m_schedulers == 0) {
+            wake();
+        }
+    }
+
+    // Whether any scheduler uses the queue. The loop can stop waking up for
+    // it once there are none left.
+    bool has_schedulers() {
+        std::lock_guard<std::mutex> lock(m_schedulers_mutex);
+        return m_schedulers > 0;
+    }
+
+private:
+    struct Work {
+        const void* owner;
+        realm::util::UniqueFunction<void()> fn;
+    };
+
+    std::mutex m_mutex;
+    std::deque<Work> m_lanes[NumLanes];
+
+    std::mutex m_schedulers_mutex;
+    size_t m_schedulers = 0;
+};
+
+// A scheduler of a realm, invoking its work in a lane of the queue of a loop.
+class QueueScheduler : public realm::util::Scheduler {
+public:
+    QueueScheduler(std::shared_ptr<WorkQueue> queue, WorkQueue::Lane lane)
+    : m_queue(std::move(queue))
+    , m_lane(lane)
+    {
+        m_queue->add_scheduler();
+    }
+
+    ~QueueScheduler() {
+        m_queue->discard(this);
+        m_queue->remove_scheduler();
+    }
+
+    virtual void invoke(realm::util::UniqueFunction<void()>&& fn) final {
+        m_queue->push(m_lane, this, std::move(fn));
+    };
+
+    virtual bool is_on_thread() const noexcept final {
+        return m_thread == std::this_thread::get_id();
+    }
+
+    virtual bool is_same_as(const realm::util::Scheduler* other) const noexcept final {
+        if (auto other_scheduler = dynamic_cast<const QueueScheduler*>(other)) {
+            return m_queue == other_scheduler->m_queue && m_lane == other_scheduler->m_lane;
+        }
+        return false;
+    }
+
+    virtual bool can_invoke() const noexcept final { return true; }
+private:
+    std::thread::id m_thread = std::this_thread::get_id();
+
+    std::shared_ptr<WorkQueue> m_queue;
+    WorkQueue::Lane m_lane;
+};
+
+#endif
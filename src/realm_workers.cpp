@@ -0,0 +1,521 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <realm/object-store/c_api/types.hpp>
+
+#include "realm_accessors.hpp"
+#include "realm_frozen.hpp"
+#include "realm_native_lib.hpp"
+#include "realm_native_scheduler.hpp"
+#include "realm_util.hpp"
+#include "realm_workers.hpp"
+
+// Release a thread-safe reference. Also tells the handles holding one apart.
+static void release_thread_safe_reference(void* value) {
+    realm_release(value);
+}
+
+static void push_reference_handle(lua_State* L, void* reference, void (*release)(void*) = release_thread_safe_reference) {
+    realm_lua_handle* handle = push_handle_node(L);
+    handle->value = reference;
+    handle->release = release;
+}
+
+// Get the handle of a thread-safe reference at the given index, or null.
+static realm_lua_handle* test_reference_handle(lua_State* L, int index) {
+    auto* handle = static_cast<realm_lua_handle*>(luaL_testudata(L, index, RealmHandle));
+    if (handle && handle->release == release_thread_safe_reference) {
+        return handle;
+    }
+
+    return nullptr;
+}
+
+static realm_lua_handle* check_reference_handle(lua_State* L, int index) {
+    realm_lua_handle* handle = test_reference_handle(L, index);
+    if (!handle) {
+        luaL_typeerror(L, index, "thread-safe reference");
+    }
+    if (!handle->value) {
+        _inform_error(L, "The thread-safe reference has already been resolved");
+    }
+
+    return handle;
+}
+
+int lib_realm_create_thread_safe_reference(lua_State* L) {
+    // Get arguments from the stack, an object proxy or a handle of results.
+    void* value;
+    if (_is_object_proxy(L, 1)) {
+        value = static_cast<ObjectProxy*>(lua_touserdata(L, 1))->object();
+    }
+    else {
+        auto* handle = static_cast<realm_lua_handle*>(luaL_checkudata(L, 1, RealmHandle));
+        if (handle->release == release_thread_safe_reference) {
+            return luaL_typeerror(L, 1, "object or results");
+        }
+        value = handle->value;
+    }
+    if (!value) {
+        return _inform_error(L, "Invalid object or results");
+    }
+
+    realm_thread_safe_reference_t* reference = realm_create_thread_safe_reference(value);
+    if (!reference) {
+        return _inform_realm_error(L);
+    }
+    push_reference_handle(L, reference);
+
+    return 1;
+}
+
+int lib_realm_object_from_thread_safe_reference(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+    realm_lua_handle* reference = check_reference_handle(L, 2);
+
+    // Resolve the reference, which can only be done once, and push the object onto the stack.
+    realm_object_t** object = push_handle<realm_object_t>(L);
+    *object = realm_object_from_thread_safe_reference(*realm, static_cast<realm_thread_safe_reference_t*>(reference->value));
+    release_handle(reference);
+    if (!*object) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+int lib_realm_results_from_thread_safe_reference(lua_State* L) {
+    // Get arguments from the stack.
+    realm_t** realm = static_cast<realm_t**>(luaL_checkudata(L, 1, RealmHandle));
+    realm_lua_handle* reference = check_reference_handle(L, 2);
+
+    // Resolve the reference, which can only be done once, and push the results onto the stack.
+    realm_results_t** results = push_handle<realm_results_t>(L);
+    *results = realm_results_from_thread_safe_reference(*realm, static_cast<realm_thread_safe_reference_t*>(reference->value));
+    release_handle(reference);
+    if (!*results) {
+        return _inform_realm_error(L);
+    }
+
+    return 1;
+}
+
+namespace workers {
+
+static const char* PoolMeta = "realm_workers_pool";
+
+// The deepest tables can be nested in a message, which also catches cycles.
+static const int MaxDepth = 32;
+
+struct ReleaseReference {
+    void operator()(void* reference) const {
+        realm_release(reference);
+    }
+};
+
+// Get the handle of a thread-safe reference or of an exported frozen realm at
+// the given index, which can be moved to another Lua state, or null.
+static realm_lua_handle* test_movable_handle(lua_State* L, int index) {
+    auto* handle = static_cast<realm_lua_handle*>(luaL_testudata(L, index, RealmHandle));
+    if (handle && (handle->release == release_thread_safe_reference || handle->release == release_exported_realm)) {
+        return handle;
+    }
+
+    return nullptr;
+}
+
+// A Lua value copied out of one Lua state to be pushed into another one.
+// Tables are copied deeply, as alternating keys and values, and the
+// thread-safe references and exported frozen realms are moved out of their
+// handles once the whole value has been copied.
+struct Message {
+    int type = LUA_TNIL;
+    bool boolean = false;
+    bool is_integer = false;
+    lua_Integer integer = 0;
+    lua_Number number = 0;
+    std::string string;
+    std::vector<Message> table;
+    std::unique_ptr<void, ReleaseReference> reference;
+    void (*release)(void*) = nullptr;
+    // The handle the reference is moved out of, until it is.
+    realm_lua_handle* source = nullptr;
+};
+
+// Copy the value at the given index into a message, or throw if it holds
+// anything but nil, booleans, numbers, strings, tables and thread-safe
+// references. The references are left in their handles.
+static void copy_tree(lua_State* L, int index, Message& message, std::unordered_set<realm_lua_handle*>& sources, int depth) {
+    index = lua_absindex(L, index);
+    message.type = lua_type(L, index);
+    switch (message.type) {
+        case LUA_TNIL:
+            break;
+        case LUA_TBOOLEAN:
+            message.boolean = lua_toboolean(L, index);
+            break;
+        case LUA_TNUMBER:
+            message.is_integer = lua_isinteger(L, index);
+            if (message.is_integer) {
+                message.integer = lua_tointeger(L, index);
+            }
+            else {
+                message.number = lua_tonumber(L, index);
+            }
+            break;
+        case LUA_TSTRING:
+            message.string = lua_tostringview(L, index);
+            break;
+        case LUA_TTABLE:
+            if (depth >= MaxDepth || !lua_checkstack(L, 2)) {
+                throw std::runtime_error("Tables sent to other Lua states cannot be nested this deep");
+            }
+            lua_pushnil(L);
+            while (lua_next(L, index)) {
+                copy_tree(L, -2, message.table.emplace_back(), sources, depth + 1);
+                copy_tree(L, -1, message.table.emplace_back(), sources, depth + 1);
+                lua_pop(L, 1);
+            }
+            break;
+        default:
+            if (realm_lua_handle* handle = test_movable_handle(L, index)) {
+                if (!handle->value || !sources.insert(handle).second) {
+                    throw std::runtime_error(handle->release == release_exported_realm
+                        ? "The frozen realm has already been imported"
+                        : "The thread-safe reference has already been resolved");
+                }
+                message.source = handle;
+                break;
+            }
+            throw std::runtime_error(realm::util::format("Cannot send a %1 to another Lua state", luaL_typename(L, index)));
+    }
+}
+
+// Move the references of a copied message out of their handles.
+static void take_references(Message& message) {
+    if (message.source) {
+        message.reference.reset(message.source->value);
+        message.release = message.source->release;
+        message.source->value = nullptr;
+        message.source = nullptr;
+    }
+    for (Message& entry : message.table) {
+        take_references(entry);
+    }
+}
+
+// Copy the value at the given index into a message, or throw if it cannot be
+// sent, leaving the references in their handles then.
+static void copy_value(lua_State* L, int index, Message& message) {
+    std::unordered_set<realm_lua_handle*> sources;
+    copy_tree(L, index, message, sources, 0);
+    take_references(message);
+}
+
+// Push the value of a message onto the stack, moving its references into new handles.
+static void push_value(lua_State* L, Message& message) {
+    luaL_checkstack(L, 3, "too many nested tables");
+    switch (message.type) {
+        case LUA_TBOOLEAN:
+            lua_pushboolean(L, message.boolean);
+            break;
+        case LUA_TNUMBER:
+            if (message.is_integer) {
+                lua_pushinteger(L, message.integer);
+            }
+            else {
+                lua_pushnumber(L, message.number);
+            }
+            break;
+        case LUA_TSTRING:
+            lua_pushlstring(L, message.string.data(), message.string.size());
+            break;
+        case LUA_TTABLE:
+            lua_createtable(L, 0, static_cast<int>(message.table.size() / 2));
+            for (size_t i = 0; i + 1 < message.table.size(); i += 2) {
+                push_value(L, message.table[i]);
+                push_value(L, message.table[i + 1]);
+                lua_rawset(L, -3);
+            }
+            break;
+        default:
+            if (message.reference) {
+                push_reference_handle(L, message.reference.release(), message.release);
+            }
+            else {
+                lua_pushnil(L);
+            }
+    }
+}
+
+struct Job {
+    lua_Integer id;
+    Message task;
+};
+
+// A pool of threads, each running its own Lua state with its own realm. Jobs
+// are submitted from the Lua state which created the pool, and their results
+// delivered back to it through its scheduler.
+class WorkerPool : public std::enable_shared_from_this<WorkerPool> {
+public:
+    WorkerPool(lua_State* L, int deliver_reference, std::shared_ptr<realm::util::Scheduler> scheduler)
+    : m_L(L)
+    , m_deliver_reference(deliver_reference)
+    , m_scheduler(std::move(scheduler))
+    { }
+
+    ~WorkerPool() {
+        close();
+        luaL_unref(m_L, LUA_REGISTRYINDEX, m_deliver_reference);
+    }
+
+    // Start a thread running a Lua state with the given package paths, which
+    // gets its realm from realm.workers with a copy of the setup.
+    void start(std::string path, std::string cpath, Message&& setup) {
+        m_threads.emplace_back([this, path = std::move(path), cpath = std::move(cpath), setup = std::move(setup)]() mutable {
+            run(path, cpath, setup);
+        });
+    }
+
+    void submit(lua_Integer id, Message&& task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back({id, std::move(task)});
+        }
+        m_available.notify_one();
+    }
+
+    // Drop the jobs which have not started yet and wait for the others.
+    // Their results are not delivered anymore.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closing = true;
+            m_jobs.clear();
+        }
+        m_available.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+private:
+    static void preload(lua_State* L, const char* name, lua_CFunction open) {
+        luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_PRELOAD_TABLE);
+        lua_pushcfunction(L, open);
+        lua_setfield(L, -2, name);
+        lua_pop(L, 1);
+    }
+
+    static int setup_state(lua_State* L) {
+        // Set the package paths (1st and 2nd arguments), preload the native
+        // modules which are already loaded in this process and push the
+        // function running the jobs, given the setup (3rd argument).
+        luaL_openlibs(L);
+        lua_getglobal(L, "package");
+        lua_pushvalue(L, 1);
+        lua_setfield(L, -2, "path");
+        lua_pushvalue(L, 2);
+        lua_setfield(L, -2, "cpath");
+        lua_pop(L, 1);
+        preload(L, "realm.native", luaopen_realm_native);
+        preload(L, "realm.scheduler.native.native", luaopen_realm_scheduler_native_native);
+        preload(L, "realm.workers.native", luaopen_realm_workers_native);
+
+        lua_getglobal(L, "require");
+        lua_pushliteral(L, "realm.workers");
+        lua_call(L, 1, 1);
+        lua_getfield(L, -1, "_worker");
+        lua_pushvalue(L, 3);
+        lua_call(L, 1, 1);
+
+        return 1;
+    }
+
+    bool take(Job& job) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_available.wait(lock, [&] { return m_closing || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            return false;
+        }
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+
+        return true;
+    }
+
+    void run(const std::string& path, const std::string& cpath, Message& setup) {
+        lua_State* L = luaL_newstate();
+        lua_pushcfunction(L, setup_state);
+        lua_pushlstring(L, path.data(), path.size());
+        lua_pushlstring(L, cpath.data(), cpath.size());
+        push_value(L, setup);
+        // Without a working state, every job fails with the error of the setup.
+        bool ready = lua_pcall(L, 3, 1, 0) == LUA_OK;
+        int runner = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        Job job;
+        while (take(job)) {
+            Message result;
+            bool ok = ready;
+            lua_rawgeti(L, LUA_REGISTRYINDEX, runner);
+            if (ready) {
+                push_value(L, job.task);
+                ok = lua_pcall(L, 1, 1, 0) == LUA_OK;
+            }
+            try {
+                copy_value(L, -1, result);
+            }
+            catch (const std::exception& e) {
+                ok = false;
+                result = Message();
+                result.type = LUA_TSTRING;
+                result.string = e.what();
+            }
+            lua_settop(L, 0);
+            complete(job.id, ok, std::move(result));
+        }
+
+        lua_close(L);
+    }
+
+    void complete(lua_Integer id, bool ok, Message&& result) {
+        m_scheduler->invoke([weak = weak_from_this(), id, ok, result = std::move(result)]() mutable {
+            if (auto pool = weak.lock()) {
+                pool->deliver(id, ok, result);
+            }
+        });
+    }
+
+    void deliver(lua_Integer id, bool ok, Message& result) {
+        if (m_closing) {
+            return;
+        }
+        lua_State* L = m_L;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, m_deliver_reference);
+        lua_pushinteger(L, id);
+        lua_pushboolean(L, ok);
+        push_value(L, result);
+        log_lua_error(L, lua_pcall(L, 3, 0, 0));
+    }
+
+    lua_State* m_L;
+    int m_deliver_reference;
+    std::shared_ptr<realm::util::Scheduler> m_scheduler;
+
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::deque<Job> m_jobs;
+    bool m_closing = false;
+    std::vector<std::thread> m_threads;
+};
+
+static std::shared_ptr<WorkerPool>& check_pool(lua_State* L, int index) {
+    return *static_cast<std::shared_ptr<WorkerPool>*>(luaL_checkudata(L, index, PoolMeta));
+}
+
+static int create_pool(lua_State* L) {
+    // Get arguments from the stack.
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    realm_scheduler_t** scheduler = static_cast<realm_scheduler_t**>(luaL_checkudata(L, 2, RealmHandle));
+    lua_Integer threads = luaL_optinteger(L, 3, std::max(std::thread::hardware_concurrency(), 1u));
+    std::string_view path = luaL_checkstring(L, 4);
+    std::string_view cpath = luaL_checkstring(L, 5);
+    luaL_checktype(L, 6, LUA_TTABLE);
+    if (threads < 1) {
+        return _inform_error(L, "A pool needs at least one worker");
+    }
+
+    // Deliver the results to the main thread, as the state which created the
+    // pool may be a coroutine which is gone by then.
+    lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+    lua_State* main_thread = lua_tothread(L, -1);
+    lua_pop(L, 1);
+    lua_pushvalue(L, 1);
+    int deliver_reference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    auto pool = static_cast<std::shared_ptr<WorkerPool>*>(lua_newuserdatauv(L, sizeof(std::shared_ptr<WorkerPool>), 0));
+    new (pool) std::shared_ptr<WorkerPool>(std::make_shared<WorkerPool>(main_thread, deliver_reference, **scheduler));
+    luaL_setmetatable(L, PoolMeta);
+    try {
+        for (lua_Integer i = 0; i < threads; i++) {
+            Message setup;
+            copy_value(L, 6, setup);
+            (*pool)->start(std::string(path), std::string(cpath), std::move(setup));
+        }
+        return 1;
+    }
+    catch (const std::exception& e) {
+        (*pool)->close();
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int pool_submit(lua_State* L) {
+    std::shared_ptr<WorkerPool>& pool = check_pool(L, 1);
+    lua_Integer id = luaL_checkinteger(L, 2);
+    try {
+        Message task;
+        copy_value(L, 3, task);
+        pool->submit(id, std::move(task));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        lua_pushstring(L, e.what());
+    }
+
+    return lua_error(L);
+}
+
+static int pool_close(lua_State* L) {
+    check_pool(L, 1)->close();
+
+    return 0;
+}
+
+static int pool_gc(lua_State* L) {
+    check_pool(L, 1).~shared_ptr();
+
+    return 0;
+}
+
+}
+
+extern "C" int luaopen_realm_workers_native(lua_State* L) {
+    luaL_Reg pool_meta[] = {
+        {"__gc", workers::pool_gc},
+        {NULL, NULL}
+    };
+    luaL_newmetatable(L, workers::PoolMeta);
+    luaL_setfuncs(L, pool_meta, 0);
+
+    luaL_Reg pool_funcs[] {
+        {"submit", workers::pool_submit},
+        {"close", workers::pool_close},
+        {NULL, NULL}
+    };
+    luaL_newlib(L, pool_funcs);
+    lua_setfield(L, -2, "__index");
+
+    lua_pop(L, 1); // pop the pool metatable
+
+    luaL_Reg funcs[] = {
+        {"create_pool", workers::create_pool},
+        {NULL, NULL}
+    };
+    luaL_newlib(L, funcs);
+
+    return 1;
+}
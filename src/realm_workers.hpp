@@ -0,0 +1,9 @@
+#include <lua.hpp>
+
+int lib_realm_create_thread_safe_reference(lua_State* L);
+
+int lib_realm_object_from_thread_safe_reference(lua_State* L);
+
+int lib_realm_results_from_thread_safe_reference(lua_State* L);
+
+extern "C" int luaopen_realm_workers_native(lua_State*);